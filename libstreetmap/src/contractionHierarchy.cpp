@@ -0,0 +1,507 @@
+#include "contractionHierarchy.h"
+#include "edgeBasedGraph.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+ContractionHierarchyCache contractionHierarchies;
+
+namespace {
+
+//Witness searches give up after settling this many arcs and keep the shortcut instead,
+//which costs a few extra shortcuts but never correctness
+const int kWitnessSettleLimit = 500;
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+typedef std::pair<double, int> HeapEntry;
+typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> MinHeap;
+
+//Arc graph that shrinks while the hierarchy is built: only uncontracted arcs stay linked
+struct DynamicEdge {
+    int arc;
+    int middle;
+    double time;
+};
+
+struct Shortcut {
+    int from;
+    int to;
+    double time;
+};
+
+//Bounded Dijkstra from one arc that never enters the arc being contracted
+class WitnessSearch {
+public:
+    explicit WitnessSearch(int numArcs) : m_time(numArcs), m_epoch(numArcs, 0), m_targetEpoch(numArcs, 0) {}
+
+    //Stops early once every arc in targets is settled, their times are final by then
+    void run(const std::vector<std::vector<DynamicEdge>>& out, int source, int avoid, const std::vector<DynamicEdge>& targets, double maxTime) {
+        m_current++;
+        int targetsLeft = 0;
+        for (const DynamicEdge& target : targets) {
+            if (m_targetEpoch[target.arc] != m_current) {
+                m_targetEpoch[target.arc] = m_current;
+                targetsLeft++;
+            }
+        }
+        m_heap.clear();
+        set(source, 0);
+        m_heap.emplace_back(0, source);
+        int settled = 0;
+        while (!m_heap.empty() && settled < kWitnessSettleLimit && targetsLeft > 0) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<HeapEntry>());
+            HeapEntry top = m_heap.back();
+            m_heap.pop_back();
+            if (top.first > time(top.second)) {
+                continue;
+            }
+            if (top.first > maxTime) {
+                break;
+            }
+            settled++;
+            if (m_targetEpoch[top.second] == m_current) {
+                targetsLeft--;
+            }
+            for (const DynamicEdge& edge : out[top.second]) {
+                double reached = top.first + edge.time;
+                if (edge.arc != avoid && reached < time(edge.arc)) {
+                    set(edge.arc, reached);
+                    m_heap.emplace_back(reached, edge.arc);
+                    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<HeapEntry>());
+                }
+            }
+        }
+    }
+
+    double time(int arc) const { return m_epoch[arc] == m_current ? m_time[arc] : kInfinity; }
+
+private:
+    void set(int arc, double value) {
+        m_time[arc] = value;
+        m_epoch[arc] = m_current;
+    }
+
+    std::vector<double> m_time;
+    std::vector<uint32_t> m_epoch;
+    std::vector<uint32_t> m_targetEpoch;
+    std::vector<HeapEntry> m_heap;      //kept between runs so the searches do not allocate
+    uint32_t m_current = 0;
+};
+
+//Shortcuts needed to contract arc, i.e. in-out pairs with no equally fast path around it
+void findShortcuts(const std::vector<std::vector<DynamicEdge>>& out, const std::vector<std::vector<DynamicEdge>>& in, int arc,
+                   WitnessSearch& witness, std::vector<Shortcut>& shortcuts) {
+    shortcuts.clear();
+    for (const DynamicEdge& incoming : in[arc]) {
+        double maxTime = 0;
+        for (const DynamicEdge& outgoing : out[arc]) {
+            maxTime = std::max(maxTime, incoming.time + outgoing.time);
+        }
+        witness.run(out, incoming.arc, arc, out[arc], maxTime);
+        for (const DynamicEdge& outgoing : out[arc]) {
+            double via = incoming.time + outgoing.time;
+            if (outgoing.arc != incoming.arc && witness.time(outgoing.arc) > via) {
+                shortcuts.push_back(Shortcut{incoming.arc, outgoing.arc, via});
+            }
+        }
+    }
+}
+
+void removeEdgeTo(std::vector<DynamicEdge>& edges, int arc) {
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [arc](const DynamicEdge& edge) { return edge.arc == arc; }), edges.end());
+}
+
+//Returns true if a new edge was added, false if an existing one was kept or made faster
+bool addOrImprove(std::vector<DynamicEdge>& edges, int arc, int middle, double time) {
+    for (DynamicEdge& edge : edges) {
+        if (edge.arc == arc) {
+            if (time < edge.time) {
+                edge.time = time;
+                edge.middle = middle;
+            }
+            return false;
+        }
+    }
+    edges.push_back(DynamicEdge{arc, middle, time});
+    return true;
+}
+
+} //namespace
+
+void ContractionHierarchy::Scratch::prepare(int numArcs) {
+    if (m_forward.size() != static_cast<size_t>(numArcs)) {
+        m_forward.assign(numArcs, Label());
+        m_backward.assign(numArcs, Label());
+        m_epoch = 0;
+    }
+    m_epoch++;
+    m_settled = 0;
+    //after a wrap-around old stamps could look current again, so pay for one full reset
+    if (m_epoch == 0) {
+        for (size_t arc = 0; arc < m_forward.size(); arc++) {
+            m_forward[arc].epoch = 0;
+            m_backward[arc].epoch = 0;
+        }
+        m_epoch = 1;
+    }
+}
+
+size_t ContractionHierarchy::Scratch::memoryBytes() const {
+    return sizeof(Scratch) + (m_forward.capacity() + m_backward.capacity()) * sizeof(Label);
+}
+
+void ContractionHierarchy::Scratch::clear() {
+    m_forward.clear();
+    m_forward.shrink_to_fit();
+    m_backward.clear();
+    m_backward.shrink_to_fit();
+    m_epoch = 0;
+    m_settled = 0;
+}
+
+void ContractionHierarchy::build(double turnPenalty) {
+    m_turnPenalty = turnPenalty;
+    m_numShortcuts = 0;
+    m_numArcs = edgeBasedGraph.numArcs();
+    int arcs = numArcs();
+
+    //original edges are the transitions of the edge-based graph, weighted for this turn penalty
+    std::vector<std::vector<DynamicEdge>> out(arcs), in(arcs);
+    for (int arc = 0; arc < arcs; arc++) {
+        for (ArcTransition transition : edgeBasedGraph.transitionsOf(arc)) {
+            double time = edgeBasedGraph.cost(transition, turnPenalty);
+            out[arc].push_back(DynamicEdge{transition.arc(), -1, time});
+            in[transition.arc()].push_back(DynamicEdge{arc, -1, time});
+        }
+    }
+
+    //contract arcs cheapest first: edge difference plus the number of already contracted
+    //neighbours, which spreads contraction evenly over the map
+    WitnessSearch witness(arcs);
+    std::vector<Shortcut> shortcuts;
+    std::vector<int> contractedNeighbours(arcs, 0);
+    auto priority = [&](int arc) {
+        findShortcuts(out, in, arc, witness, shortcuts);
+        return static_cast<int>(shortcuts.size()) - static_cast<int>(in[arc].size() + out[arc].size()) + contractedNeighbours[arc];
+    };
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> order;
+    std::vector<int> queuedPriority(arcs);
+    for (int arc = 0; arc < arcs; arc++) {
+        queuedPriority[arc] = priority(arc);
+        order.emplace(queuedPriority[arc], arc);
+    }
+
+    std::vector<bool> contracted(arcs, false);
+    std::vector<std::vector<Edge>> upward(arcs), downward(arcs);
+    while (!order.empty()) {
+        int arc = order.top().second;
+        int queued = order.top().first;
+        order.pop();
+        if (contracted[arc] || queued != queuedPriority[arc]) {
+            continue;
+        }
+        //recheck before contracting, the witness searches may have changed since arc was queued
+        int current = priority(arc);
+        if (!order.empty() && current > order.top().first) {
+            queuedPriority[arc] = current;
+            order.emplace(current, arc);
+            continue;
+        }
+
+        for (const DynamicEdge& edge : out[arc]) {
+            upward[arc].push_back(Edge{edge.arc, edge.middle, edge.time});
+            removeEdgeTo(in[edge.arc], arc);
+            contractedNeighbours[edge.arc]++;
+        }
+        for (const DynamicEdge& edge : in[arc]) {
+            downward[arc].push_back(Edge{edge.arc, edge.middle, edge.time});
+            removeEdgeTo(out[edge.arc], arc);
+            contractedNeighbours[edge.arc]++;
+        }
+        //shortcuts still holds the result of priority(arc) above
+        for (const Shortcut& shortcut : shortcuts) {
+            if (addOrImprove(out[shortcut.from], shortcut.to, arc, shortcut.time)) {
+                m_numShortcuts++;
+            }
+            addOrImprove(in[shortcut.to], shortcut.from, arc, shortcut.time);
+        }
+        out[arc].clear();
+        out[arc].shrink_to_fit();
+        in[arc].clear();
+        in[arc].shrink_to_fit();
+        contracted[arc] = true;
+
+        //the neighbours lost an edge and may have gained shortcuts, so requeue them at their new priority
+        for (const std::vector<Edge>* neighbours : {&upward[arc], &downward[arc]}) {
+            for (const Edge& edge : *neighbours) {
+                int updated = priority(edge.arc);
+                if (updated != queuedPriority[edge.arc]) {
+                    queuedPriority[edge.arc] = updated;
+                    order.emplace(updated, edge.arc);
+                }
+            }
+        }
+    }
+    storeHierarchy(upward, downward);
+}
+
+void ContractionHierarchy::storeHierarchy(const std::vector<std::vector<Edge>>& upward, const std::vector<std::vector<Edge>>& downward) {
+    m_upBegin.assign(1, 0);
+    m_up.clear();
+    m_downBegin.assign(1, 0);
+    m_down.clear();
+    for (int arc = 0; arc < numArcs(); arc++) {
+        m_up.insert(m_up.end(), upward[arc].begin(), upward[arc].end());
+        m_upBegin.push_back(m_up.size());
+        m_down.insert(m_down.end(), downward[arc].begin(), downward[arc].end());
+        m_downBegin.push_back(m_down.size());
+    }
+    m_up.shrink_to_fit();
+    m_down.shrink_to_fit();
+}
+
+std::vector<StreetSegmentIdx> ContractionHierarchy::findPath(IntersectionIdx source, IntersectionIdx destination, Scratch& scratch) const {
+    scratch.prepare(numArcs());
+    if (source == destination) {
+        return {};
+    }
+    uint32_t epoch = scratch.m_epoch;
+    std::vector<Scratch::Label>& forward = scratch.m_forward;
+    std::vector<Scratch::Label>& backward = scratch.m_backward;
+    auto reached = [epoch](const Scratch::Label& label) { return label.epoch == epoch; };
+
+    //the forward search starts on every arc leaving the source (paying for that arc),
+    //the backward search on every arc arriving at the destination
+    MinHeap forwardHeap, backwardHeap;
+    for (ArcIdx arc : edgeBasedGraph.departures(source)) {
+        forward[arc] = Scratch::Label{edgeBasedGraph.travelTime(arc), -1, -1, epoch};
+        forwardHeap.emplace(edgeBasedGraph.travelTime(arc), arc);
+    }
+    for (ArcIdx arc : edgeBasedGraph.arrivals(destination)) {
+        backward[arc] = Scratch::Label{0, -1, -1, epoch};
+        backwardHeap.emplace(0, arc);
+    }
+
+    double best = kInfinity;
+    int meeting = -1;
+    while (!forwardHeap.empty() || !backwardHeap.empty()) {
+        double forwardTop = forwardHeap.empty() ? kInfinity : forwardHeap.top().first;
+        double backwardTop = backwardHeap.empty() ? kInfinity : backwardHeap.top().first;
+        //neither side can still reach a better meeting arc
+        if (std::min(forwardTop, backwardTop) >= best) {
+            break;
+        }
+        bool forwardStep = forwardTop <= backwardTop;
+        MinHeap& heap = forwardStep ? forwardHeap : backwardHeap;
+        std::vector<Scratch::Label>& labels = forwardStep ? forward : backward;
+        const std::vector<Scratch::Label>& other = forwardStep ? backward : forward;
+        const std::vector<uint32_t>& begin = forwardStep ? m_upBegin : m_downBegin;
+        const std::vector<Edge>& edges = forwardStep ? m_up : m_down;
+
+        HeapEntry top = heap.top();
+        heap.pop();
+        int arc = top.second;
+        if (top.first > labels[arc].time) {
+            continue;
+        }
+        scratch.m_settled++;
+        if (reached(other[arc]) && top.first + other[arc].time < best) {
+            best = top.first + other[arc].time;
+            meeting = arc;
+        }
+        for (uint32_t edge = begin[arc]; edge < begin[arc + 1]; edge++) {
+            double time = top.first + edges[edge].time;
+            Scratch::Label& next = labels[edges[edge].arc];
+            if (!reached(next) || time < next.time) {
+                next = Scratch::Label{time, arc, static_cast<int32_t>(edge), epoch};
+                heap.emplace(time, edges[edge].arc);
+            }
+        }
+    }
+    if (meeting < 0) {
+        return {};
+    }
+
+    //walk the forward tree back to the source, then unpack every hierarchy edge on the way out
+    std::vector<int> upChain;
+    for (int arc = meeting; arc >= 0; arc = forward[arc].parent) {
+        upChain.push_back(arc);
+    }
+    std::vector<int> arcs = {upChain.back()};
+    for (size_t step = upChain.size() - 1; step > 0; step--) {
+        int from = upChain[step];
+        int to = upChain[step - 1];
+        unpack(from, to, m_up[forward[to].edge].middle, arcs);
+    }
+    for (int arc = meeting; backward[arc].parent >= 0; arc = backward[arc].parent) {
+        unpack(arc, backward[arc].parent, m_down[backward[arc].edge].middle, arcs);
+    }
+
+    std::vector<StreetSegmentIdx> path;
+    path.reserve(arcs.size());
+    for (int arc : arcs) {
+        path.push_back(EdgeBasedGraph::segmentOf(arc));
+    }
+    return path;
+}
+
+void ContractionHierarchy::searchUpward(IntersectionIdx intersection, bool forward, Scratch& scratch, std::vector<SearchTreeArc>& tree) const {
+    scratch.prepare(numArcs());
+    tree.clear();
+    uint32_t epoch = scratch.m_epoch;
+    std::vector<Scratch::Label>& labels = forward ? scratch.m_forward : scratch.m_backward;
+    auto reached = [&](int arc) { return labels[arc].epoch == epoch; };
+    //edges the search follows, and the opposite ones through which a higher arc can stall it
+    const std::vector<uint32_t>& begin = forward ? m_upBegin : m_downBegin;
+    const std::vector<Edge>& edges = forward ? m_up : m_down;
+    const std::vector<uint32_t>& stallBegin = forward ? m_downBegin : m_upBegin;
+    const std::vector<Edge>& stallEdges = forward ? m_down : m_up;
+
+    MinHeap heap;
+    if (forward) {
+        for (ArcIdx arc : edgeBasedGraph.departures(intersection)) {
+            labels[arc] = Scratch::Label{edgeBasedGraph.travelTime(arc), -1, -1, epoch};
+            heap.emplace(edgeBasedGraph.travelTime(arc), arc);
+        }
+    } else {
+        for (ArcIdx arc : edgeBasedGraph.arrivals(intersection)) {
+            labels[arc] = Scratch::Label{0, -1, -1, epoch};
+            heap.emplace(0, arc);
+        }
+    }
+    while (!heap.empty()) {
+        HeapEntry top = heap.top();
+        heap.pop();
+        int arc = top.second;
+        if (top.first > labels[arc].time) {
+            continue;
+        }
+        scratch.m_settled++;
+        bool stalled = false;
+        for (uint32_t edge = stallBegin[arc]; edge < stallBegin[arc + 1] && !stalled; edge++) {
+            int higher = stallEdges[edge].arc;
+            stalled = reached(higher) && labels[higher].time + stallEdges[edge].time < top.first;
+        }
+        if (stalled) {
+            continue;
+        }
+        //labels of this search point at tree entries rather than arcs, the tree outlives the scratch
+        int32_t entry = static_cast<int32_t>(tree.size());
+        tree.push_back(SearchTreeArc{arc, labels[arc].parent, labels[arc].edge, top.first});
+        for (uint32_t edge = begin[arc]; edge < begin[arc + 1]; edge++) {
+            double time = top.first + edges[edge].time;
+            Scratch::Label& next = labels[edges[edge].arc];
+            if (!reached(edges[edge].arc) || time < next.time) {
+                next = Scratch::Label{time, entry, static_cast<int32_t>(edge), epoch};
+                heap.emplace(time, edges[edge].arc);
+            }
+        }
+    }
+}
+
+std::vector<StreetSegmentIdx> ContractionHierarchy::unpackPath(const std::vector<SearchTreeArc>& forward, int forwardArc,
+                                                               const std::vector<SearchTreeArc>& backward, int backwardArc) const {
+    std::vector<int> upChain;
+    for (int entry = forwardArc; entry >= 0; entry = forward[entry].parent) {
+        upChain.push_back(entry);
+    }
+    std::vector<int> arcs = {forward[upChain.back()].arc};
+    for (size_t step = upChain.size() - 1; step > 0; step--) {
+        const SearchTreeArc& to = forward[upChain[step - 1]];
+        unpack(forward[upChain[step]].arc, to.arc, m_up[to.edge].middle, arcs);
+    }
+    for (int entry = backwardArc; backward[entry].parent >= 0; entry = backward[entry].parent) {
+        unpack(backward[entry].arc, backward[backward[entry].parent].arc, m_down[backward[entry].edge].middle, arcs);
+    }
+
+    std::vector<StreetSegmentIdx> path;
+    path.reserve(arcs.size());
+    for (int arc : arcs) {
+        path.push_back(EdgeBasedGraph::segmentOf(arc));
+    }
+    return path;
+}
+
+const ContractionHierarchy::Edge* ContractionHierarchy::findEdge(const std::vector<uint32_t>& begin, const std::vector<Edge>& edges, int owner, int arc) const {
+    for (uint32_t edge = begin[owner]; edge < begin[owner + 1]; edge++) {
+        if (edges[edge].arc == arc) {
+            return &edges[edge];
+        }
+    }
+    return nullptr;
+}
+
+//Appends the original arcs after from on the way to to (to included, from not)
+void ContractionHierarchy::unpack(int from, int to, int middle, std::vector<int>& arcs) const {
+    if (middle < 0) {
+        arcs.push_back(to);
+        return;
+    }
+    //both halves were recorded when middle was contracted, so they sit in middle's lists
+    const Edge* first = findEdge(m_downBegin, m_down, middle, from);
+    const Edge* second = findEdge(m_upBegin, m_up, middle, to);
+    unpack(from, middle, first->middle, arcs);
+    unpack(middle, to, second->middle, arcs);
+}
+
+size_t ContractionHierarchy::memoryBytes() const {
+    return sizeof(ContractionHierarchy) + (m_upBegin.capacity() + m_downBegin.capacity()) * sizeof(uint32_t) +
+           (m_up.capacity() + m_down.capacity()) * sizeof(Edge);
+}
+
+const ContractionHierarchy& ContractionHierarchyCache::forTurnPenalty(double turnPenalty) {
+    Entry* entry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (const auto& candidate : m_hierarchies) {
+            if (candidate->turnPenalty == turnPenalty) {
+                entry = candidate.get();
+                break;
+            }
+        }
+        if (entry == nullptr) {
+            m_hierarchies.push_back(std::make_unique<Entry>());
+            entry = m_hierarchies.back().get();
+            entry->turnPenalty = turnPenalty;
+        }
+    }
+    //other threads asking for the same penalty wait here instead of building it again; if the
+    //build throws, the next caller retries it
+    std::call_once(entry->buildOnce, [entry]() {
+        entry->hierarchy.build(entry->turnPenalty);
+        entry->ready.store(true, std::memory_order_release);
+    });
+    return entry->hierarchy;
+}
+
+const ContractionHierarchy* ContractionHierarchyCache::built(double turnPenalty) const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (const auto& entry : m_hierarchies) {
+        if (entry->turnPenalty == turnPenalty && entry->ready.load(std::memory_order_acquire)) {
+            return &entry->hierarchy;
+        }
+    }
+    return nullptr;
+}
+
+size_t ContractionHierarchyCache::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    size_t bytes = sizeof(ContractionHierarchyCache);
+    //hierarchies still being built are left out rather than read mid-build
+    for (const auto& entry : m_hierarchies) {
+        if (entry->ready.load(std::memory_order_acquire)) {
+            bytes += sizeof(Entry) - sizeof(ContractionHierarchy) + entry->hierarchy.memoryBytes();
+        }
+    }
+    return bytes;
+}
+
+void ContractionHierarchyCache::clear() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    //a build in progress finishes before its entry goes; entries never built are just dropped
+    for (const auto& entry : m_hierarchies) {
+        std::call_once(entry->buildOnce, []() {});
+    }
+    m_hierarchies.clear();
+}
@@ -0,0 +1,119 @@
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include "StreetsDatabaseAPI.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//Contraction Hierarchy over edgeBasedGraph for one turn penalty. Every node is an arc (a
+//directed traversal of a street segment) and every original edge a transition costing the next
+//arc's travel time plus the turn penalty when the street changes, so the hierarchy answers
+//queries exactly in computePathTravelTime's metric.
+class ContractionHierarchy {
+public:
+    //Per-thread query state, epoch-stamped so a query only touches the arcs it visits
+    class Scratch {
+    public:
+        void prepare(int numArcs);
+        //Arcs settled by the last query, for comparing engines
+        size_t settledArcs() const { return m_settled; }
+        size_t memoryBytes() const;
+        void clear();
+    private:
+        friend class ContractionHierarchy;
+        struct Label {
+            double time;
+            int32_t parent;         //previous arc on this side, -1 at the start
+            int32_t edge;           //hierarchy edge from parent (forward) or to parent (backward)
+            uint32_t epoch = 0;
+        };
+        std::vector<Label> m_forward;
+        std::vector<Label> m_backward;
+        uint32_t m_epoch = 0;
+        size_t m_settled = 0;
+    };
+
+    //Arc settled by searchUpward; parent is the index of the previous arc in the same search
+    //(-1 where it started) and edge the hierarchy edge between the two
+    struct SearchTreeArc {
+        int32_t arc;
+        int32_t parent;
+        int32_t edge;
+        double time;
+    };
+
+    //Orders the arcs and adds shortcuts; needs edgeBasedGraph
+    void build(double turnPenalty);
+
+    //Fastest path from source to destination as street segments; empty if there is none
+    //or source == destination
+    std::vector<StreetSegmentIdx> findPath(IntersectionIdx source, IntersectionIdx destination, Scratch& scratch) const;
+
+    //One half of a query run to exhaustion, for many-to-many searches: upward from source over
+    //its departing arcs (forward) or backward into a destination over its arriving arcs. Arcs a
+    //higher arc reaches faster are stalled and left out, no fastest path can meet on them.
+    void searchUpward(IntersectionIdx intersection, bool forward, Scratch& scratch, std::vector<SearchTreeArc>& tree) const;
+    //Street segments of the path meeting on forward[forwardArc].arc == backward[backwardArc].arc
+    std::vector<StreetSegmentIdx> unpackPath(const std::vector<SearchTreeArc>& forward, int forwardArc,
+                                             const std::vector<SearchTreeArc>& backward, int backwardArc) const;
+
+    double turnPenalty() const { return m_turnPenalty; }
+    int numArcs() const { return m_numArcs; }
+    size_t numShortcuts() const { return m_numShortcuts; }
+    size_t memoryBytes() const;
+
+private:
+    //Edge of the upward (or reversed downward) search graph; middle is the contracted arc a
+    //shortcut skips, -1 for an original turn
+    struct Edge {
+        int32_t arc;
+        int32_t middle;
+        double time;
+    };
+
+    void storeHierarchy(const std::vector<std::vector<Edge>>& upward, const std::vector<std::vector<Edge>>& downward);
+    const Edge* findEdge(const std::vector<uint32_t>& begin, const std::vector<Edge>& edges, int owner, int arc) const;
+    void unpack(int from, int to, int middle, std::vector<int>& arcs) const;
+
+    double m_turnPenalty = 0;
+    int m_numArcs = 0;
+    size_t m_numShortcuts = 0;
+
+    //m_up holds the edges from each arc to higher ranked arcs; m_down holds, for each arc,
+    //the edges coming into it from higher ranked arcs (walked backwards by the reverse search)
+    std::vector<uint32_t> m_upBegin;
+    std::vector<Edge> m_up;
+    std::vector<uint32_t> m_downBegin;
+    std::vector<Edge> m_down;
+};
+
+//Hierarchies built on first use for each turn penalty and kept until the map is closed.
+//Safe to query from several threads; concurrent first uses of one penalty build it once.
+//Builds run outside the cache lock, so only callers that need the hierarchy being built wait.
+class ContractionHierarchyCache {
+public:
+    const ContractionHierarchy& forTurnPenalty(double turnPenalty);
+    //The hierarchy for turnPenalty if it has been built already, nullptr otherwise
+    const ContractionHierarchy* built(double turnPenalty) const;
+    size_t memoryBytes() const;
+    void clear();
+
+private:
+    struct Entry {
+        double turnPenalty;
+        std::once_flag buildOnce;
+        std::atomic<bool> ready{false};
+        ContractionHierarchy hierarchy;
+    };
+
+    mutable std::mutex m_lock;          //guards m_hierarchies, not the builds
+    std::vector<std::unique_ptr<Entry>> m_hierarchies;
+};
+
+extern ContractionHierarchyCache contractionHierarchies;
+
+#endif //CONTRACTIONHIERARCHY_H
@@ -0,0 +1,168 @@
+#include "edgeBasedGraph.h"
+#include "samiristhegoat.h"
+#include "streetGraph.h"
+#include <algorithm>
+
+EdgeBasedGraph edgeBasedGraph;
+
+void EdgeBasedGraph::build() {
+    int numSegments = getNumStreetSegments();
+    m_arcHead.resize(2 * numSegments);
+    m_arcTime.resize(2 * numSegments);
+    for (StreetSegmentIdx segment = 0; segment < numSegments; segment++) {
+        const StreetSegmentInfo& info = street_segment_info[segment];
+        double time = street_segment_length[segment] / info.speedLimit;
+        m_arcHead[arcOf(segment, false)] = info.to;
+        m_arcHead[arcOf(segment, true)] = info.from;
+        m_arcTime[arcOf(segment, false)] = time;
+        m_arcTime[arcOf(segment, true)] = time;
+    }
+
+    //departures in streetGraph order; a loop segment is listed once and only needs its forward arc
+    m_departureBegin.assign(1, 0);
+    m_departures.clear();
+    for (IntersectionIdx intersection = 0; intersection < streetGraph.numIntersections(); intersection++) {
+        size_t first = m_departures.size();
+        for (const StreetGraphEdge& edge : streetGraph.edgesOf(intersection)) {
+            if (!edge.traversable) {
+                continue;
+            }
+            ArcIdx arc = arcOf(edge.segment, street_segment_info[edge.segment].from != intersection);
+            if (std::find(m_departures.begin() + first, m_departures.end(), arc) == m_departures.end()) {
+                m_departures.push_back(arc);
+            }
+        }
+        m_departureBegin.push_back(m_departures.size());
+    }
+
+    m_arrivalBegin.assign(streetGraph.numIntersections() + 1, 0);
+    for (ArcIdx arc : m_departures) {
+        m_arrivalBegin[m_arcHead[arc] + 1]++;
+    }
+    for (int intersection = 0; intersection < streetGraph.numIntersections(); intersection++) {
+        m_arrivalBegin[intersection + 1] += m_arrivalBegin[intersection];
+    }
+    m_arrivals.resize(m_departures.size());
+    std::vector<uint32_t> next(m_arrivalBegin.begin(), m_arrivalBegin.end() - 1);
+    for (ArcIdx arc : m_departures) {
+        m_arrivals[next[m_arcHead[arc]]++] = arc;
+    }
+
+    //every traversable arc may continue on any arc leaving its head, u-turns included;
+    //arcs that cannot be travelled keep an empty run
+    m_transitionBegin.assign(1, 0);
+    m_transitions.clear();
+    std::vector<bool> traversable(numArcs(), false);
+    for (ArcIdx arc : m_departures) {
+        traversable[arc] = true;
+    }
+    for (ArcIdx arc = 0; arc < numArcs(); arc++) {
+        if (traversable[arc]) {
+            StreetIdx street = street_segment_info[segmentOf(arc)].streetID;
+            for (ArcIdx nextArc : departures(m_arcHead[arc])) {
+                ArcTransition transition;
+                transition.m_packed = static_cast<uint32_t>(nextArc);
+                if (street_segment_info[segmentOf(nextArc)].streetID != street) {
+                    transition.m_packed |= ArcTransition::kTurnBit;
+                }
+                m_transitions.push_back(transition);
+            }
+        }
+        m_transitionBegin.push_back(m_transitions.size());
+    }
+
+    //the same transitions grouped by the arc they enter
+    m_reverseTransitionBegin.assign(numArcs() + 1, 0);
+    for (ArcTransition transition : m_transitions) {
+        m_reverseTransitionBegin[transition.arc() + 1]++;
+    }
+    for (ArcIdx arc = 0; arc < numArcs(); arc++) {
+        m_reverseTransitionBegin[arc + 1] += m_reverseTransitionBegin[arc];
+    }
+    m_reverseTransitions.resize(m_transitions.size());
+    std::vector<uint32_t> nextReverse(m_reverseTransitionBegin.begin(), m_reverseTransitionBegin.end() - 1);
+    for (ArcIdx arc = 0; arc < numArcs(); arc++) {
+        for (ArcTransition transition : transitionsOf(arc)) {
+            ArcTransition reverse;
+            reverse.m_packed = static_cast<uint32_t>(arc) | (transition.m_packed & ArcTransition::kTurnBit);
+            m_reverseTransitions[nextReverse[transition.arc()]++] = reverse;
+        }
+    }
+}
+
+size_t EdgeBasedGraph::memoryBytes() const {
+    return sizeof(EdgeBasedGraph) + m_arcHead.capacity() * sizeof(IntersectionIdx) + m_arcTime.capacity() * sizeof(double) +
+           (m_transitionBegin.capacity() + m_reverseTransitionBegin.capacity() + m_departureBegin.capacity() + m_arrivalBegin.capacity()) * sizeof(uint32_t) +
+           (m_transitions.capacity() + m_reverseTransitions.capacity()) * sizeof(ArcTransition) +
+           (m_departures.capacity() + m_arrivals.capacity()) * sizeof(ArcIdx);
+}
+
+void EdgeBasedGraph::clear() {
+    m_arcHead.clear();
+    m_arcHead.shrink_to_fit();
+    m_arcTime.clear();
+    m_arcTime.shrink_to_fit();
+    m_transitionBegin.assign(1, 0);
+    m_transitionBegin.shrink_to_fit();
+    m_transitions.clear();
+    m_transitions.shrink_to_fit();
+    m_reverseTransitionBegin.assign(1, 0);
+    m_reverseTransitionBegin.shrink_to_fit();
+    m_reverseTransitions.clear();
+    m_reverseTransitions.shrink_to_fit();
+    m_departureBegin.assign(1, 0);
+    m_departureBegin.shrink_to_fit();
+    m_departures.clear();
+    m_departures.shrink_to_fit();
+    m_arrivalBegin.assign(1, 0);
+    m_arrivalBegin.shrink_to_fit();
+    m_arrivals.clear();
+    m_arrivals.shrink_to_fit();
+}
+
+namespace {
+
+bool offsetsConsistent(const std::vector<uint32_t>& begin, size_t numRuns, size_t numValues) {
+    if (begin.size() != numRuns + 1 || begin.front() != 0 || begin.back() != numValues) {
+        return false;
+    }
+    for (size_t run = 0; run < numRuns; run++) {
+        if (begin[run + 1] < begin[run]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace
+
+bool EdgeBasedGraph::columnsConsistent() const {
+    size_t arcs = 2 * static_cast<size_t>(getNumStreetSegments());
+    size_t intersections = getNumIntersections();
+    if (m_arcHead.size() != arcs || m_arcTime.size() != arcs || !offsetsConsistent(m_transitionBegin, arcs, m_transitions.size()) ||
+        !offsetsConsistent(m_reverseTransitionBegin, arcs, m_reverseTransitions.size()) ||
+        !offsetsConsistent(m_departureBegin, intersections, m_departures.size()) ||
+        !offsetsConsistent(m_arrivalBegin, intersections, m_arrivals.size())) {
+        return false;
+    }
+    for (IntersectionIdx head : m_arcHead) {
+        if (head < 0 || static_cast<size_t>(head) >= intersections) {
+            return false;
+        }
+    }
+    for (const std::vector<ArcTransition>* transitions : {&m_transitions, &m_reverseTransitions}) {
+        for (ArcTransition transition : *transitions) {
+            if (static_cast<size_t>(transition.arc()) >= arcs) {
+                return false;
+            }
+        }
+    }
+    for (const std::vector<ArcIdx>* arcList : {&m_departures, &m_arrivals}) {
+        for (ArcIdx arc : *arcList) {
+            if (arc < 0 || static_cast<size_t>(arc) >= arcs) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
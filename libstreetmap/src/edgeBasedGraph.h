@@ -0,0 +1,123 @@
+#ifndef EDGEBASEDGRAPH_H
+#define EDGEBASEDGRAPH_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <vector>
+
+//Directed traversal of a street segment: arc 2s runs from -> to along segment s, arc 2s + 1 runs to -> from
+typedef int ArcIdx;
+
+//Non-owning view of a run of arc ids, usable in range-for loops
+class ArcRange {
+public:
+    ArcRange(const ArcIdx* first, const ArcIdx* last) : m_first(first), m_last(last) {}
+    const ArcIdx* begin() const { return m_first; }
+    const ArcIdx* end() const { return m_last; }
+    size_t size() const { return m_last - m_first; }
+private:
+    const ArcIdx* m_first;
+    const ArcIdx* m_last;
+};
+
+//One allowed move from an arc onto an arc leaving its head intersection. The street-change
+//flag lives in the top bit so a transition is a single word.
+class ArcTransition {
+public:
+    ArcIdx arc() const { return static_cast<ArcIdx>(m_packed & ~kTurnBit); }
+    bool turn() const { return (m_packed & kTurnBit) != 0; }
+
+private:
+    friend class EdgeBasedGraph;
+    static constexpr uint32_t kTurnBit = 0x80000000u;
+    uint32_t m_packed;
+};
+
+class ArcTransitionRange {
+public:
+    ArcTransitionRange(const ArcTransition* first, const ArcTransition* last) : m_first(first), m_last(last) {}
+    const ArcTransition* begin() const { return m_first; }
+    const ArcTransition* end() const { return m_last; }
+    size_t size() const { return m_last - m_first; }
+private:
+    const ArcTransition* m_first;
+    const ArcTransition* m_last;
+};
+
+//Edge-based street graph: nodes are arcs and edges are the transitions between them. Taking
+//a transition costs the travel time of the arc entered plus the turn penalty when the street
+//changes, which is exactly computePathTravelTime's metric, so searches over arcs never depend
+//on the order nodes were settled in. Transitions are stored once in CSR form and weighted per
+//query, since the turn penalty is only known then.
+class EdgeBasedGraph {
+public:
+    //Needs street_segment_info, street_segment_length and streetGraph
+    void build();
+
+    static ArcIdx arcOf(StreetSegmentIdx segment, bool reversed) { return 2 * segment + (reversed ? 1 : 0); }
+    static StreetSegmentIdx segmentOf(ArcIdx arc) { return arc >> 1; }
+
+    int numArcs() const { return static_cast<int>(m_arcHead.size()); }
+    size_t numTransitions() const { return m_transitions.size(); }
+    IntersectionIdx head(ArcIdx arc) const { return m_arcHead[arc]; }
+    double travelTime(ArcIdx arc) const { return m_arcTime[arc]; }
+    //Cost of entering arc from the previous one, with or without a change of street
+    double enterCost(ArcIdx arc, bool turn, double turnPenalty) const { return m_arcTime[arc] + (turn ? turnPenalty : 0); }
+    //Cost of taking a forward transition, i.e. of entering its arc
+    double cost(ArcTransition transition, double turnPenalty) const { return enterCost(transition.arc(), transition.turn(), turnPenalty); }
+
+    ArcTransitionRange transitionsOf(ArcIdx arc) const {
+        return ArcTransitionRange(m_transitions.data() + m_transitionBegin[arc], m_transitions.data() + m_transitionBegin[arc + 1]);
+    }
+    //Transitions into arc, for searches that run backwards from the destination; each names the
+    //previous arc and costs enterCost(arc, turn), so one-way segments are only walked against
+    //the direction they can be driven
+    ArcTransitionRange reverseTransitionsOf(ArcIdx arc) const {
+        return ArcTransitionRange(m_reverseTransitions.data() + m_reverseTransitionBegin[arc],
+                                  m_reverseTransitions.data() + m_reverseTransitionBegin[arc + 1]);
+    }
+    //Traversable arcs leaving / entering an intersection (one-way segments only in their direction)
+    ArcRange departures(IntersectionIdx intersection) const {
+        return ArcRange(m_departures.data() + m_departureBegin[intersection], m_departures.data() + m_departureBegin[intersection + 1]);
+    }
+    ArcRange arrivals(IntersectionIdx intersection) const {
+        return ArcRange(m_arrivals.data() + m_arrivalBegin[intersection], m_arrivals.data() + m_arrivalBegin[intersection + 1]);
+    }
+
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if the offsets and ids are in range for the loaded map
+    bool columnsConsistent() const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_arcHead);
+        visit(m_arcTime);
+        visit(m_transitionBegin);
+        visit(m_transitions);
+        visit(m_reverseTransitionBegin);
+        visit(m_reverseTransitions);
+        visit(m_departureBegin);
+        visit(m_departures);
+        visit(m_arrivalBegin);
+        visit(m_arrivals);
+    }
+
+private:
+    std::vector<IntersectionIdx> m_arcHead;
+    std::vector<double> m_arcTime;
+    std::vector<uint32_t> m_transitionBegin = std::vector<uint32_t>(1, 0);
+    std::vector<ArcTransition> m_transitions;
+    std::vector<uint32_t> m_reverseTransitionBegin = std::vector<uint32_t>(1, 0);
+    std::vector<ArcTransition> m_reverseTransitions;
+    std::vector<uint32_t> m_departureBegin = std::vector<uint32_t>(1, 0);
+    std::vector<ArcIdx> m_departures;
+    std::vector<uint32_t> m_arrivalBegin = std::vector<uint32_t>(1, 0);
+    std::vector<ArcIdx> m_arrivals;
+};
+
+extern EdgeBasedGraph edgeBasedGraph;
+
+#endif //EDGEBASEDGRAPH_H
@@ -0,0 +1,71 @@
+#include "heuristicGeometry.h"
+#include "m1.h"
+#include "samiristhegoat.h"
+#include <cfloat>
+
+HeuristicGeometry heuristicGeometry;
+
+void HeuristicGeometry::build() {
+    int intersections = getNumIntersections();
+    m_points.resize(intersections);
+    if (intersections == 0 || max_speed_limit <= 0) {
+        std::fill(m_points.begin(), m_points.end(), Point{0, 0});
+        m_shrink = 0;
+        m_slack = 0;
+        return;
+    }
+
+    //segment lengths are summed over curve points, which can reach past the intersections
+    double minLat = getIntersectionPosition(0).latitude(), maxLat = minLat;
+    double minLon = getIntersectionPosition(0).longitude(), maxLon = minLon;
+    auto include = [&](LatLon position) {
+        minLat = std::min(minLat, static_cast<double>(position.latitude()));
+        maxLat = std::max(maxLat, static_cast<double>(position.latitude()));
+        minLon = std::min(minLon, static_cast<double>(position.longitude()));
+        maxLon = std::max(maxLon, static_cast<double>(position.longitude()));
+    };
+    for (IntersectionIdx intersection = 0; intersection < intersections; intersection++) {
+        include(getIntersectionPosition(intersection));
+    }
+    for (StreetSegmentIdx segment = 0; segment < getNumStreetSegments(); segment++) {
+        for (int curvePoint = 0; curvePoint < street_segment_info[segment].numCurvePoints; curvePoint++) {
+            include(getStreetSegmentCurvePoint(segment, curvePoint));
+        }
+    }
+
+    //findDistanceBetweenTwoPoints scales longitude by the cosine of the mean latitude of its two
+    //points, never less than the cosine at the map's highest latitude
+    double highestLatitude = std::max(std::abs(minLat), std::abs(maxLat)) * kDegreeToRadian;
+    double secondsPerRadian = kEarthRadiusInMeters / max_speed_limit;
+    double eastScale = secondsPerRadian * std::cos(highestLatitude);
+    double centreLat = (minLat + maxLat) * 0.5 * kDegreeToRadian;
+    double centreLon = (minLon + maxLon) * 0.5 * kDegreeToRadian;
+    for (IntersectionIdx intersection = 0; intersection < intersections; intersection++) {
+        LatLon position = getIntersectionPosition(intersection);
+        Point& point = m_points[intersection];
+        point.x = static_cast<float>((position.longitude() * kDegreeToRadian - centreLon) * eastScale);
+        point.y = static_cast<float>((position.latitude() * kDegreeToRadian - centreLat) * secondsPerRadian);
+    }
+    finish();
+}
+
+void HeuristicGeometry::finish() {
+    float largest = 0;
+    for (const Point& point : m_points) {
+        largest = std::max(largest, std::max(std::abs(point.x), std::abs(point.y)));
+    }
+    //each coordinate is off by at most half an ulp of the largest one, the distance by a few ulps of itself
+    m_shrink = 1 - 8 * FLT_EPSILON;
+    m_slack = 4 * FLT_EPSILON * largest;
+}
+
+size_t HeuristicGeometry::memoryBytes() const {
+    return sizeof(HeuristicGeometry) + m_points.capacity() * sizeof(Point);
+}
+
+void HeuristicGeometry::clear() {
+    m_points.clear();
+    m_points.shrink_to_fit();
+    m_shrink = 1;
+    m_slack = 0;
+}
@@ -0,0 +1,80 @@
+#ifndef HEURISTICGEOMETRY_H
+#define HEURISTICGEOMETRY_H
+
+#include "StreetsDatabaseAPI.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+//Allocator for vectors whose storage starts on a cache line
+template <typename T, size_t Alignment = 64>
+struct CacheAlignedAllocator {
+    typedef T value_type;
+    template <typename U>
+    struct rebind {
+        typedef CacheAlignedAllocator<U, Alignment> other;
+    };
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* pointer, size_t) { ::operator delete(pointer, std::align_val_t(Alignment)); }
+    bool operator==(const CacheAlignedAllocator&) const { return true; }
+    bool operator!=(const CacheAlignedAllocator&) const { return false; }
+};
+
+//Intersections projected once for the A* heuristics. Every position is stored in seconds of
+//driving at max_speed_limit, east and north of the map centre, with the east axis scaled by
+//the cosine of the map's highest latitude. That projection never lengthens a distance
+//findDistanceBetweenTwoPoints measures anywhere on the map, so the straight line between two
+//points is a lower bound on the travel time and a bound on the time left costs a subtraction,
+//two multiplies and a square root. x and y of one intersection are adjacent, so a lookup
+//touches one cache line.
+class HeuristicGeometry {
+public:
+    struct Point {
+        float x;
+        float y;
+    };
+
+    //Needs street_segment_info's curve points and max_speed_limit; the points are kept in the
+    //map snapshot, so this only runs when the map data is rebuilt
+    void build();
+
+    const Point& position(IntersectionIdx intersection) const { return m_points[intersection]; }
+    //Lower bound on the driving time between an intersection and a point; hoist the point out of loops
+    float timeBetween(IntersectionIdx intersection, Point point) const {
+        const Point& from = m_points[intersection];
+        float dx = from.x - point.x;
+        float dy = from.y - point.y;
+        return std::max(0.0f, std::sqrt(dx * dx + dy * dy) * m_shrink - m_slack);
+    }
+
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if there is a point per intersection; call finish() afterwards
+    bool columnsConsistent() const { return m_points.size() == static_cast<size_t>(getNumIntersections()); }
+    //Derives the rounding allowance after the points were filled through visitColumns
+    void finish();
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_points);
+    }
+
+private:
+    std::vector<Point, CacheAlignedAllocator<Point>> m_points;
+    //float rounding of the coordinates and of the distance, taken off so the bound stays a bound
+    float m_shrink = 1;
+    float m_slack = 0;
+};
+
+extern HeuristicGeometry heuristicGeometry;
+
+#endif //HEURISTICGEOMETRY_H
@@ -0,0 +1,184 @@
+#include "landmarks.h"
+#include "streetGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+LandmarkTable landmarkTable;
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+//floats keep about 7 digits, so every difference of two stored times is shrunk by this much
+//of their sum to stay a lower bound
+const double kFloatSlack = 1e-6;
+
+//Plain Dijkstra over the intersection graph without turn penalties; backward follows segments
+//against their driving direction, so time[v] ends up as d(v, source)
+void landmarkDijkstra(IntersectionIdx source, bool backward, std::vector<double>& time) {
+    time.assign(streetGraph.numIntersections(), kInfinity);
+    typedef std::pair<double, IntersectionIdx> HeapEntry;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    time[source] = 0;
+    heap.emplace(0, source);
+    while (!heap.empty()) {
+        HeapEntry top = heap.top();
+        heap.pop();
+        if (top.first > time[top.second]) {
+            continue;
+        }
+        for (const StreetGraphEdge& edge : streetGraph.edgesOf(top.second)) {
+            //a one-way edge that cannot leave this intersection is exactly one that can enter it
+            bool usable = backward ? (!edge.oneWay || !edge.traversable) : edge.traversable;
+            double reached = top.first + edge.travelTime;
+            if (usable && reached < time[edge.to]) {
+                time[edge.to] = reached;
+                heap.emplace(reached, edge.to);
+            }
+        }
+    }
+}
+
+//An intersection of the largest connected component, ignoring driving direction, so the
+//landmarks spread over the main road network rather than an island that holds intersection 0
+IntersectionIdx largestComponentMember() {
+    int intersections = streetGraph.numIntersections();
+    std::vector<int> component(intersections, -1);
+    std::vector<IntersectionIdx> stack;
+    IntersectionIdx best = 0;
+    int bestSize = 0;
+    for (IntersectionIdx start = 0; start < intersections; start++) {
+        if (component[start] >= 0) {
+            continue;
+        }
+        int size = 0;
+        component[start] = start;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            IntersectionIdx intersection = stack.back();
+            stack.pop_back();
+            size++;
+            for (const StreetGraphEdge& edge : streetGraph.edgesOf(intersection)) {
+                if (component[edge.to] < 0) {
+                    component[edge.to] = start;
+                    stack.push_back(edge.to);
+                }
+            }
+        }
+        if (size > bestSize) {
+            best = start;
+            bestSize = size;
+        }
+    }
+    return best;
+}
+
+} //namespace
+
+void LandmarkTable::selectLandmarks() {
+    int intersections = streetGraph.numIntersections();
+    m_landmarks.clear();
+    if (intersections == 0) {
+        m_fromLandmark.clear();
+        m_toLandmark.clear();
+        return;
+    }
+    m_fromLandmark.assign(static_cast<size_t>(intersections) * kNumLandmarks, 0);
+    m_toLandmark.assign(static_cast<size_t>(intersections) * kNumLandmarks, 0);
+
+    //farthest selection: each landmark is the reachable intersection farthest from the ones picked
+    //so far, starting from the one farthest from a member of the largest component
+    std::vector<double> time;
+    std::vector<double> nearestLandmark;
+    std::vector<bool> picked(intersections, false);
+    IntersectionIdx start = largestComponentMember();
+    landmarkDijkstra(start, false, nearestLandmark);
+    while (numLandmarks() < kNumLandmarks) {
+        IntersectionIdx farthest = -1;
+        for (IntersectionIdx intersection = 0; intersection < intersections; intersection++) {
+            if (!picked[intersection] && std::isfinite(nearestLandmark[intersection]) &&
+                (farthest < 0 || nearestLandmark[intersection] > nearestLandmark[farthest])) {
+                farthest = intersection;
+            }
+        }
+        //fewer reachable intersections than landmarks: take any unpicked one, and on maps with
+        //fewer intersections than landmarks repeat the start so the table keeps its width
+        if (farthest < 0) {
+            farthest = std::find(picked.begin(), picked.end(), false) - picked.begin();
+            if (farthest == intersections) {
+                farthest = start;
+            }
+        }
+        picked[farthest] = true;
+        int landmark = numLandmarks();
+        m_landmarks.push_back(farthest);
+        landmarkDijkstra(farthest, false, time);
+        for (IntersectionIdx intersection = 0; intersection < intersections; intersection++) {
+            m_fromLandmark[static_cast<size_t>(intersection) * kNumLandmarks + landmark] = static_cast<float>(time[intersection]);
+            //the first pass only measured from the start, which is not a landmark
+            if (landmark == 0 || time[intersection] < nearestLandmark[intersection]) {
+                nearestLandmark[intersection] = time[intersection];
+            }
+        }
+    }
+}
+
+void LandmarkTable::fillBackward(int begin, int end) {
+    std::vector<double> time;
+    for (int landmark = begin; landmark < end && landmark < numLandmarks(); landmark++) {
+        landmarkDijkstra(m_landmarks[landmark], true, time);
+        for (IntersectionIdx intersection = 0; intersection < streetGraph.numIntersections(); intersection++) {
+            m_toLandmark[static_cast<size_t>(intersection) * kNumLandmarks + landmark] = static_cast<float>(time[intersection]);
+        }
+    }
+}
+
+double LandmarkTable::lowerBound(IntersectionIdx from, IntersectionIdx to) const {
+    const float* fromFrom = m_fromLandmark.data() + static_cast<size_t>(from) * numLandmarks();
+    const float* fromTo = m_fromLandmark.data() + static_cast<size_t>(to) * numLandmarks();
+    const float* toFrom = m_toLandmark.data() + static_cast<size_t>(from) * numLandmarks();
+    const float* toTo = m_toLandmark.data() + static_cast<size_t>(to) * numLandmarks();
+    double bound = 0;
+    for (int landmark = 0; landmark < numLandmarks(); landmark++) {
+        //terms with an unreachable side say nothing useful and would produce inf - inf
+        double landmarkToTarget = fromTo[landmark], landmarkToSource = fromFrom[landmark];
+        if (std::isfinite(landmarkToTarget) && std::isfinite(landmarkToSource)) {
+            bound = std::max(bound, landmarkToTarget - landmarkToSource - kFloatSlack * (landmarkToTarget + landmarkToSource));
+        }
+        double sourceToLandmark = toFrom[landmark], targetToLandmark = toTo[landmark];
+        if (std::isfinite(sourceToLandmark) && std::isfinite(targetToLandmark)) {
+            bound = std::max(bound, sourceToLandmark - targetToLandmark - kFloatSlack * (sourceToLandmark + targetToLandmark));
+        }
+    }
+    return bound;
+}
+
+size_t LandmarkTable::memoryBytes() const {
+    return sizeof(LandmarkTable) + m_landmarks.capacity() * sizeof(IntersectionIdx) +
+           (m_fromLandmark.capacity() + m_toLandmark.capacity()) * sizeof(float);
+}
+
+void LandmarkTable::clear() {
+    m_landmarks.clear();
+    m_landmarks.shrink_to_fit();
+    m_fromLandmark.clear();
+    m_fromLandmark.shrink_to_fit();
+    m_toLandmark.clear();
+    m_toLandmark.shrink_to_fit();
+}
+
+bool LandmarkTable::columnsConsistent() const {
+    size_t cells = static_cast<size_t>(getNumIntersections()) * numLandmarks();
+    if ((getNumIntersections() > 0 && numLandmarks() != kNumLandmarks) || m_fromLandmark.size() != cells || m_toLandmark.size() != cells) {
+        return false;
+    }
+    for (IntersectionIdx landmark : m_landmarks) {
+        if (landmark < 0 || landmark >= getNumIntersections()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <vector>
+
+//Travel times to and from a few landmark intersections, for ALT lower bounds: by the triangle
+//inequality d(v, t) >= d(L, t) - d(L, v) and d(v, t) >= d(v, L) - d(t, L). The times ignore turn
+//penalties, which only make paths longer, so the bounds hold for every turn penalty.
+//Tables are node-major floats (all landmarks of one intersection are adjacent), so one bound
+//reads two short runs.
+class LandmarkTable {
+public:
+    static constexpr int kNumLandmarks = 16;
+
+    //Picks the landmarks by farthest selection, filling the forward tables on the way; needs streetGraph
+    void selectLandmarks();
+    //Fills the backward tables of landmarks [begin, end); safe in parallel on disjoint ranges
+    void fillBackward(int begin, int end);
+
+    //Lower bound on the travel time from one intersection to another, 0 if nothing is known
+    double lowerBound(IntersectionIdx from, IntersectionIdx to) const;
+
+    int numLandmarks() const { return static_cast<int>(m_landmarks.size()); }
+    const std::vector<IntersectionIdx>& landmarks() const { return m_landmarks; }
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if the tables match the loaded map
+    bool columnsConsistent() const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_landmarks);
+        visit(m_fromLandmark);
+        visit(m_toLandmark);
+    }
+
+private:
+    std::vector<IntersectionIdx> m_landmarks;
+    std::vector<float> m_fromLandmark;      //[intersection * numLandmarks + l] = d(landmark l, intersection)
+    std::vector<float> m_toLandmark;        //[intersection * numLandmarks + l] = d(intersection, landmark l)
+};
+
+extern LandmarkTable landmarkTable;
+
+#endif //LANDMARKS_H
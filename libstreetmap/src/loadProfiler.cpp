@@ -0,0 +1,376 @@
+#include "loadProfiler.h"
+#include "taskGraph.h"
+#include "samiristhegoat.h"
+#include "streetGraph.h"
+#include "edgeBasedGraph.h"
+#include "landmarks.h"
+#include "streetIndex.h"
+#include "heuristicGeometry.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <sstream>
+#include <type_traits>
+
+LoadProfile loadProfile;
+
+#ifdef MAPPER_COUNT_ALLOCATIONS
+
+namespace {
+thread_local uint64_t allocatedBytes = 0;
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+    //aligned_alloc wants a nonzero size that is a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void* memory = std::aligned_alloc(align, ((size == 0 ? 1 : size) + align - 1) / align * align);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    allocatedBytes += size;
+    return memory;
+}
+} //namespace
+
+uint64_t threadAllocatedBytes() {
+    return allocatedBytes;
+}
+
+//Counting replacements for the global allocation functions, compiled into profile builds
+//only so they never sit under a sanitizer's allocator. They only add one thread-local
+//increment to malloc. libstdc++ routes the nothrow variants through these, but the
+//aligned ones call aligned_alloc directly, so they are replaced as well.
+void* operator new(std::size_t size) {
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    allocatedBytes += size;
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAlignedAlloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAlignedAlloc(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+#else
+
+uint64_t threadAllocatedBytes() {
+    return 0;
+}
+
+#endif //MAPPER_COUNT_ALLOCATIONS
+
+namespace {
+
+//Resident size estimates: the object itself is counted by its owner, heapBytes only
+//adds the blocks the object owns. libstdc++ keeps strings up to 15 chars inline.
+size_t heapBytes(const std::string& value);
+size_t heapBytes(const Intersection_data& value);
+size_t heapBytes(const POI_data& value);
+size_t heapBytes(const featureStruct& value);
+size_t heapBytes(const std::vector<bool>& value);
+template <typename T> size_t heapBytes(const T&);
+template <typename A, typename B> size_t heapBytes(const std::pair<A, B>& value);
+template <typename T> size_t heapBytes(const std::vector<T>& value);
+template <typename T> size_t heapBytes(const std::set<T>& value);
+template <typename K, typename V> size_t heapBytes(const std::unordered_map<K, V>& value);
+
+//red-black tree and hash nodes carry a few pointers (and a cached hash) next to the value
+const size_t kTreeNodeOverhead = 4 * sizeof(void*);
+const size_t kHashNodeOverhead = 2 * sizeof(void*);
+
+size_t heapBytes(const std::string& value) {
+    return value.capacity() > 15 ? value.capacity() + 1 : 0;
+}
+
+size_t heapBytes(const Intersection_data& value) {
+    return heapBytes(value.name);
+}
+
+size_t heapBytes(const POI_data& value) {
+    return heapBytes(value.name) + heapBytes(value.type);
+}
+
+size_t heapBytes(const featureStruct& value) {
+    return heapBytes(value.featurePoints) + heapBytes(value.type);
+}
+
+size_t heapBytes(const std::vector<bool>& value) {
+    return (value.capacity() + 7) / 8;
+}
+
+template <typename T>
+size_t heapBytes(const T&) {
+    static_assert(std::is_trivially_copyable<T>::value, "add a heapBytes overload for types that own memory");
+    return 0;
+}
+
+template <typename A, typename B>
+size_t heapBytes(const std::pair<A, B>& value) {
+    return heapBytes(value.first) + heapBytes(value.second);
+}
+
+template <typename T>
+size_t heapBytes(const std::vector<T>& value) {
+    size_t bytes = value.capacity() * sizeof(T);
+    for (const T& element : value) {
+        bytes += heapBytes(element);
+    }
+    return bytes;
+}
+
+template <typename T>
+size_t heapBytes(const std::set<T>& value) {
+    return value.size() * (sizeof(T) + kTreeNodeOverhead);
+}
+
+template <typename K, typename V>
+size_t heapBytes(const std::unordered_map<K, V>& value) {
+    size_t bytes = value.bucket_count() * sizeof(void*) + value.size() * (sizeof(std::pair<const K, V>) + kHashNodeOverhead);
+    for (const auto& entry : value) {
+        bytes += heapBytes(entry.first) + heapBytes(entry.second);
+    }
+    return bytes;
+}
+
+ContainerRecord record(const std::string& name, size_t entries, size_t bytes) {
+    ContainerRecord container;
+    container.name = name;
+    container.entries = entries;
+    container.bytes = bytes;
+    return container;
+}
+
+//Standard containers, sized from their capacities and element heap blocks
+template <typename Container>
+ContainerRecord measure(const std::string& name, const Container& container) {
+    return record(name, container.size(), sizeof(Container) + heapBytes(container));
+}
+
+std::string jsonEscape(const std::string& value) {
+    std::string escaped;
+    for (char character : value) {
+        if (character == '"' || character == '\\') {
+            escaped += '\\';
+        }
+        escaped += character;
+    }
+    return escaped;
+}
+
+#ifdef MAPPER_COUNT_ALLOCATIONS
+constexpr bool kCountsAllocations = true;
+#else
+constexpr bool kCountsAllocations = false;
+#endif
+
+std::string formatBytes(uint64_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (bytes >= (1ULL << 30)) {
+        out << bytes / double(1ULL << 30) << " GiB";
+    } else if (bytes >= (1ULL << 20)) {
+        out << bytes / double(1ULL << 20) << " MiB";
+    } else if (bytes >= (1ULL << 10)) {
+        out << bytes / double(1ULL << 10) << " KiB";
+    } else {
+        out << bytes << " B";
+    }
+    return out.str();
+}
+
+} //namespace
+
+void LoadProfile::clear(const std::string& mapName) {
+    m_mapName = mapName;
+    m_fromSnapshot = false;
+    m_totalSeconds = 0;
+    m_start = std::chrono::steady_clock::now();
+    m_phases.clear();
+    m_phaseStarts.clear();
+    m_containers.clear();
+    m_criticalPath.clear();
+    m_criticalPathReport.clear();
+}
+
+double LoadProfile::secondsSinceStart() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void LoadProfile::addPhase(const std::string& name, double startSeconds, double endSeconds, int thread, uint64_t bytesAllocated) {
+    auto phase = std::find_if(m_phases.begin(), m_phases.end(), [&name](const LoadPhaseRecord& record) { return record.name == name; });
+    if (phase == m_phases.end()) {
+        LoadPhaseRecord record;
+        record.name = name;
+        m_phases.push_back(record);
+        m_phaseStarts.push_back(startSeconds);
+        phase = m_phases.end() - 1;
+    }
+    double& phaseStart = m_phaseStarts[phase - m_phases.begin()];
+    phaseStart = std::min(phaseStart, startSeconds);
+    phase->wallSeconds = std::max(phase->wallSeconds, endSeconds - phaseStart);
+    phase->cpuSeconds += endSeconds - startSeconds;
+    phase->tasks++;
+    phase->threads.insert(thread);
+    phase->bytesAllocated += bytesAllocated;
+}
+
+void LoadProfile::addTaskGraph(const TaskGraph& graph) {
+    double offset = std::chrono::duration<double>(graph.runStart() - m_start).count();
+    for (const TaskGraph::TaskTiming& timing : graph.timings()) {
+        if (!timing.phase.empty()) {
+            addPhase(timing.phase, offset + timing.start, offset + timing.end, timing.worker, timing.bytesAllocated);
+        }
+    }
+    for (TaskGraph::TaskId task : graph.criticalPath()) {
+        m_criticalPath.push_back(graph.timings()[task].name);
+    }
+    std::ostringstream report;
+    graph.printCriticalPath(report);
+    m_criticalPathReport += report.str();
+}
+
+void LoadProfile::measureContainers() {
+    m_containers.clear();
+    m_containers.push_back(record("streetGraph", streetGraph.numEdges(), streetGraph.memoryBytes()));
+    m_containers.push_back(record("edgeBasedGraph", edgeBasedGraph.numTransitions(), edgeBasedGraph.memoryBytes()));
+    m_containers.push_back(record("landmarkTable", landmarkTable.numLandmarks(), landmarkTable.memoryBytes()));
+    m_containers.push_back(record("heuristicGeometry", getNumIntersections(), heuristicGeometry.memoryBytes()));
+    m_containers.push_back(measure("street_street_segments", street_street_segments));
+    m_containers.push_back(record("streetIntersectionIndex", streetIntersectionIndex.numStreets(), streetIntersectionIndex.memoryBytes()));
+    m_containers.push_back(measure("street_lengths", street_lengths));
+    m_containers.push_back(measure("street_segment_length", street_segment_length));
+    m_containers.push_back(measure("street_segment_info", street_segment_info));
+    m_containers.push_back(record("streetNameIndex", getNumStreets(), streetNameIndex.memoryBytes()));
+    m_containers.push_back(measure("intersections_xyposname", intersections_xyposname));
+    m_containers.push_back(record("OSMNodesandTags", OSMNodesandTags.numEntities(), OSMNodesandTags.memoryBytes()));
+    m_containers.push_back(record("OSMWaysandTags", OSMWaysandTags.numEntities(), OSMWaysandTags.memoryBytes()));
+    m_containers.push_back(measure("streetSegmentIdx_point2dxyCurvepoints", streetSegmentIdx_point2dxyCurvepoints));
+    m_containers.push_back(measure("poi_information", poi_information));
+    m_containers.push_back(measure("Features", Features));
+    m_containers.push_back(measure("cityIndexes", cityIndexes));
+    m_containers.push_back(record("intersectionSpatialIndex", intersectionSpatialIndex.size(), intersectionSpatialIndex.memoryBytes()));
+    m_containers.push_back(record("poiSpatialIndex", poiSpatialIndex.size(), poiSpatialIndex.memoryBytes()));
+    m_containers.push_back(measure("pathGlobalBool", pathGlobalBool));
+    std::sort(m_containers.begin(), m_containers.end(), [](const ContainerRecord& a, const ContainerRecord& b) { return a.bytes > b.bytes; });
+}
+
+void LoadProfile::finish(bool fromSnapshot) {
+    m_fromSnapshot = fromSnapshot;
+    m_totalSeconds = secondsSinceStart();
+}
+
+void LoadProfile::printTable(std::ostream& out) const {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "Load profile for " << m_mapName << " (" << (m_fromSnapshot ? "snapshot" : "rebuild") << ", "
+        << std::fixed << std::setprecision(3) << m_totalSeconds << "s)" << std::endl;
+    out << std::left << std::setw(28) << "Phase" << std::right << std::setw(10) << "Wall(s)" << std::setw(10) << "CPU(s)"
+        << std::setw(8) << "Tasks" << std::setw(9) << "Threads" << std::setw(14) << "Allocated" << std::endl;
+    for (const LoadPhaseRecord& phase : m_phases) {
+        out << std::left << std::setw(28) << phase.name << std::right << std::setw(10) << phase.wallSeconds << std::setw(10) << phase.cpuSeconds
+            << std::setw(8) << phase.tasks << std::setw(9) << phase.threads.size() << std::setw(14) << (kCountsAllocations ? formatBytes(phase.bytesAllocated) : "-") << std::endl;
+    }
+    out << std::left << std::setw(40) << "Container" << std::right << std::setw(12) << "Entries" << std::setw(14) << "Resident" << std::endl;
+    size_t totalBytes = 0;
+    for (const ContainerRecord& container : m_containers) {
+        out << std::left << std::setw(40) << container.name << std::right << std::setw(12) << container.entries
+            << std::setw(14) << formatBytes(container.bytes) << std::endl;
+        totalBytes += container.bytes;
+    }
+    out << std::left << std::setw(52) << "Total" << std::right << std::setw(14) << formatBytes(totalBytes) << std::endl;
+    out << m_criticalPathReport;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void LoadProfile::printJson(std::ostream& out) const {
+    out << "{\"map\":\"" << jsonEscape(m_mapName) << "\",\"source\":\"" << (m_fromSnapshot ? "snapshot" : "rebuild")
+        << "\",\"total_seconds\":" << m_totalSeconds << ",\"phases\":[";
+    for (size_t phase = 0; phase < m_phases.size(); phase++) {
+        const LoadPhaseRecord& record = m_phases[phase];
+        out << (phase ? "," : "") << "{\"name\":\"" << jsonEscape(record.name) << "\",\"wall_seconds\":" << record.wallSeconds
+            << ",\"cpu_seconds\":" << record.cpuSeconds << ",\"tasks\":" << record.tasks << ",\"threads\":[";
+        for (auto thread = record.threads.begin(); thread != record.threads.end(); ++thread) {
+            out << (thread != record.threads.begin() ? "," : "") << *thread;
+        }
+        out << "],\"bytes_allocated\":";
+        if (kCountsAllocations) {
+            out << record.bytesAllocated << "}";
+        } else {
+            out << "null}";
+        }
+    }
+    out << "],\"containers\":[";
+    for (size_t container = 0; container < m_containers.size(); container++) {
+        out << (container ? "," : "") << "{\"name\":\"" << m_containers[container].name << "\",\"entries\":" << m_containers[container].entries
+            << ",\"bytes\":" << m_containers[container].bytes << "}";
+    }
+    out << "],\"critical_path\":[";
+    for (size_t task = 0; task < m_criticalPath.size(); task++) {
+        out << (task ? "," : "") << "\"" << jsonEscape(m_criticalPath[task]) << "\"";
+    }
+    out << "]}" << std::endl;
+}
+
+ScopedLoadPhase::ScopedLoadPhase(const std::string& name)
+    : m_name(name), m_start(loadProfile.secondsSinceStart()), m_bytesAtStart(threadAllocatedBytes()) {
+}
+
+ScopedLoadPhase::~ScopedLoadPhase() {
+    loadProfile.addPhase(m_name, m_start, loadProfile.secondsSinceStart(), 0, threadAllocatedBytes() - m_bytesAtStart);
+}
+
+void reportLoadProfile(std::ostream& out) {
+    const char* format = std::getenv("MAPPER_LOAD_PROFILE");
+    if (format == nullptr) {
+        return;
+    }
+    if (std::string(format) == "json") {
+        loadProfile.printJson(out);
+    } else {
+        loadProfile.printTable(out);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef LOADPROFILER_H
+#define LOADPROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+class TaskGraph;
+
+//Bytes requested from operator new by the calling thread since it started. Only builds
+//with MAPPER_COUNT_ALLOCATIONS (CONF=profile) replace the global operator new to keep
+//this count; elsewhere it is always 0 and the profile leaves allocations out.
+uint64_t threadAllocatedBytes();
+
+struct LoadPhaseRecord {
+    std::string name;
+    double wallSeconds = 0;     //first start to last end of the phase
+    double cpuSeconds = 0;      //summed over every task/chunk of the phase
+    int tasks = 0;
+    std::set<int> threads;      //worker indices that ran part of the phase (0 is the loading thread)
+    uint64_t bytesAllocated = 0;
+};
+
+struct ContainerRecord {
+    std::string name;
+    size_t entries = 0;
+    size_t bytes = 0;           //object plus every heap block it owns, estimated from capacities
+};
+
+//Profile of the most recent loadMap: per-phase duration, threads and allocations,
+//plus the resident size of the global map containers once loading is done.
+class LoadProfile {
+public:
+    void clear(const std::string& mapName);
+    void addPhase(const std::string& name, double startSeconds, double endSeconds, int thread, uint64_t bytesAllocated);
+    //folds the task timings of a finished load graph into phases (chunks are grouped by phase name)
+    void addTaskGraph(const TaskGraph& graph);
+    void measureContainers();
+    void finish(bool fromSnapshot);
+
+    double secondsSinceStart() const;
+    void printTable(std::ostream& out) const;
+    void printJson(std::ostream& out) const;
+
+    const std::vector<LoadPhaseRecord>& phases() const { return m_phases; }
+    const std::vector<ContainerRecord>& containers() const { return m_containers; }
+
+private:
+    std::string m_mapName;
+    bool m_fromSnapshot = false;
+    double m_totalSeconds = 0;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<LoadPhaseRecord> m_phases;
+    std::vector<double> m_phaseStarts;
+    std::vector<ContainerRecord> m_containers;
+    std::vector<std::string> m_criticalPath;
+    std::string m_criticalPathReport;   //printCriticalPath output of each load graph, for the table
+};
+
+extern LoadProfile loadProfile;
+
+//Times a phase that runs on the loading thread, e.g. opening the databases
+class ScopedLoadPhase {
+public:
+    explicit ScopedLoadPhase(const std::string& name);
+    ~ScopedLoadPhase();
+private:
+    std::string m_name;
+    double m_start;
+    uint64_t m_bytesAtStart;
+};
+
+//Prints the profile, including the load graph's critical path, when MAPPER_LOAD_PROFILE is
+//set to "table" or "json"; nothing is printed otherwise
+void reportLoadProfile(std::ostream& out);
+
+#endif //LOADPROFILER_H
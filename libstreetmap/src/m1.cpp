@@ -23,15 +23,28 @@
 #include "StreetsDatabaseAPI.h"
 #include <cmath>
 #include <algorithm>
+#include <cstdlib>
 #include "OSMDatabaseAPI.h"
 #include "ezgl/application.hpp"
 #include "ezgl/graphics.hpp"
 #include "samiristhegoat.h"
+#include "mapSnapshot.h"
+#include "taskGraph.h"
+#include "loadProfiler.h"
+#include "streetGraph.h"
+#include "edgeBasedGraph.h"
+#include "landmarks.h"
+#include "streetIndex.h"
+#include "spatialIndex.h"
+#include "contractionHierarchy.h"
+#include "routingContext.h"
+#include "routeCache.h"
+#include "heuristicGeometry.h"
 #include "ezgl/point.hpp"
 
-std::string toLowerString(std::string);
-std::string shortVersion(std::string input, int size);
 void sortPOITypes(std::string type, int poiID);
+void buildMapData();
+void configureOSMTagIndex();
 
 // loadMap will be called with the name of the file that stores the "layer-2"
 // map data accessed through StreetsDatabaseAPI: the street and intersection 
@@ -46,15 +59,9 @@ void sortPOITypes(std::string type, int poiID);
 // ".streets" to ".osm" in the map_streets_database_filename to get the proper
 // name.
 
-//vector of intersections with vectors of street segments
-std::vector <std::vector <StreetSegmentIdx>> intersection_street_segments;
-
 //vector of streets with vectors of street segments 
 std::vector <std::vector <StreetSegmentIdx>> street_street_segments;
 
-//vector of streets with set of intersections
-std::vector <std::set <IntersectionIdx>> street_intersections; 
-
 //vector of streets with vectors of street lengths
 std::vector <std::vector <double>> street_lengths;
 
@@ -64,14 +71,11 @@ std::vector<double> street_segment_length;
 //vector of street segments with vectors streetsegmentinfo objects
 std::vector<StreetSegmentInfo> street_segment_info;
 
-//Map of OSMid, and vector of pairs with strings key, and value
-std::unordered_map< OSMID , std::vector <std::pair<std::string, std::string>>>OSMNodesandTags;
-
-//Map of OSMid, and vector of pairs with strings key, and value
-std::unordered_map< OSMID , std::vector <std::pair<std::string, std::string>>>OSMWaysandTags;
+//Interned key/value tags of every tagged OSM node, looked up by OSMid
+OSMTagStore OSMNodesandTags;
 
-//Map of combination of three letter and streetsegments
-std::unordered_map < std::string , std::vector<StreetIdx> > allStreetsKeys;
+//Interned key/value tags of every tagged OSM way, looked up by OSMid
+OSMTagStore OSMWaysandTags;
 
 //Vector of intersecion_data (latlon position and intersection names)
 std::vector<Intersection_data> intersections_xyposname;
@@ -89,8 +93,10 @@ std::vector<POI_data> poi_information;
 //Vectors of City Names and Locations (String, Point2D)
 
 std::vector <int> cityIndexes;
-//Vector of Nodes
-std::vector <Node> nodes;
+//k-d tree over intersection positions (ids are intersection ids)
+SpatialIndex intersectionSpatialIndex;
+//one k-d tree per raw POI type (ids are POI ids)
+CategorySpatialIndex poiSpatialIndex;
 
 //Vector of flags that indicate which street segments are part of the path
 std::vector <bool> pathGlobalBool;
@@ -106,9 +112,16 @@ float max_speed_limit;
 bool loadMap(std::string map_streets_database_filename) {
     
     auto startTime = std::chrono::high_resolution_clock::now();
+    loadProfile.clear(map_streets_database_filename);
+    //cached routes belong to whichever map was loaded before
+    routeCache.invalidate();
 
     //load the streets database and pass result into boolean flag (load_successful)
-    bool load_successful = loadStreetsDatabaseBIN(map_streets_database_filename);
+    bool load_successful;
+    {
+        ScopedLoadPhase phase("streets database");
+        load_successful = loadStreetsDatabaseBIN(map_streets_database_filename);
+    }
 
     
     std::string OSMFileName = map_streets_database_filename;
@@ -122,232 +135,316 @@ bool loadMap(std::string map_streets_database_filename) {
 
     
 
-    bool load_osm_successful = loadOSMDatabaseBIN(OSMFileName);
+    bool load_osm_successful;
+    {
+        ScopedLoadPhase phase("OSM database");
+        load_osm_successful = loadOSMDatabaseBIN(OSMFileName);
+    }
 
+    bool fromSnapshot = false;
     if (load_successful && load_osm_successful) {
 
-        //resizing the vectors to the appropriate size
-        intersection_street_segments.resize(getNumIntersections());
-        street_street_segments.resize(getNumStreets());
-        street_intersections.resize(getNumStreets());
-        street_segment_info.resize(getNumStreetSegments());
-        street_segment_length.resize(getNumStreetSegments());
-        street_segment_info.resize(getNumStreetSegments());
-        street_segment_length.resize(getNumStreetSegments());
-        street_lengths.resize(getNumStreets());
-        intersections_xyposname.resize(getNumIntersections());
-        streetSegmentIdx_point2dxyCurvepoints.resize(getNumStreetSegments());  
-        Features.resize(getNumFeatures());
+        //path flags are not part of the snapshot; routing contexts size themselves on their first query
         pathGlobalBool.resize(getNumStreetSegments());
-        nodes.resize(getNumIntersections());
-
-        std::thread t1 {[](){
-            //Vector of intersections with accompanying street segments (intersection_street_segments)
-            //populating the intersection_street_segments nested vector with all intersections(+their connected intersections)
-            for (int intersection = 0; intersection < getNumIntersections(); ++intersection) {  //iterating over all the intersections in the map
-                for (int numIntersection = 0; numIntersection < getNumIntersectionStreetSegment(intersection); ++numIntersection) {       //iterating over all the street segments connected to the current intersection
-                    int ss_id = getIntersectionStreetSegment(intersection, numIntersection); 
-                    intersection_street_segments[intersection].push_back(ss_id);
-                }
-            }
-        }};
-        std::thread t2 {[](){
-            //Vector of streets with accompanying street segments (street_street_segments)
-            //populating the street_street_segments nested vector with all streets(+ their associated street segments)
-            for (int streetSegment = 0; streetSegment < getNumStreetSegments(); ++streetSegment) {      //iterating over all street segments in the map
-                StreetSegmentInfo currentStreetSegment = getStreetSegmentInfo(streetSegment);           
-                street_street_segments[currentStreetSegment.streetID].push_back(streetSegment);
-            }
+        configureOSMTagIndex();
 
-            //Vector of streets with accompanying intersections (street_intersections)
-            //populating the street_intersections nested vector with all streets(+ their associated intersections)
-            for (int street = 0; street < getNumStreets(); ++street) {                                                          //iterating over all streets in the map
-                for (int streetSegments = 0; streetSegments < street_street_segments[street].size(); ++streetSegments) {        //iterating over all the street segments in the map
-                    StreetSegmentInfo currentSegment = getStreetSegmentInfo(street_street_segments[street][streetSegments]);    //storing the getStreetInfo function return in currentSegment object                                              
+        //reuse the derived containers from a previous run when the snapshot is still valid,
+        //otherwise rebuild them from the databases and refresh the snapshot
+        {
+            ScopedLoadPhase phase("load snapshot");
+            fromSnapshot = loadMapSnapshot(map_streets_database_filename, OSMFileName);
+        }
+        if (!fromSnapshot) {
+            buildMapData();
+            ScopedLoadPhase phase("save snapshot");
+            saveMapSnapshot(map_streets_database_filename, OSMFileName);
+        }
+        loadProfile.measureContainers();
+    }
+    loadProfile.finish(fromSnapshot);
+    reportLoadProfile(std::cout);
+    auto currTime = std::chrono::high_resolution_clock::now();
+    auto wallClock = std::chrono::duration_cast<std::chrono::duration<double>>(currTime - startTime);
+    std::cout << "Load Map: " << wallClock.count() << std::endl;
+    return load_successful;
+}
 
-                            street_intersections[street].insert(currentSegment.from);                                        //store in vector if searchfrom == false
+// Chooses which OSM tags are copied while loading. By default (lazy) only the keys
+// the renderer reads are indexed and every other key is read from the OSM database
+// on first use; MAPPER_TAG_INDEX=eager copies every tag up front.
+void configureOSMTagIndex() {
+    const char* mode = std::getenv("MAPPER_TAG_INDEX");
+    bool eager = mode != nullptr && std::string(mode) == "eager";
+    OSMNodesandTags.configure(OSMEntityKind::Node, eager ? std::vector<std::string>() : std::vector<std::string>{"name", "place"});
+    OSMWaysandTags.configure(OSMEntityKind::Way, eager ? std::vector<std::string>() : std::vector<std::string>{"highway", "name"});
+}
 
-                            street_intersections[street].insert(currentSegment.to); 
-                    
-                }
-            }
-            //Vector of streets with accompanying street lengths (street_lengths)
-            //populating the street_lengths nested vector with all streets(+ their accompanying lengths)
-            for (int street = 0; street < getNumStreets(); street++) {
-                double streetLength = 0;
-                for (int streetSegments = 0; streetSegments < street_street_segments[street].size(); streetSegments++) {
-                    streetLength += findStreetSegmentLength(street_street_segments[street][streetSegments]);            //iterate through the street segments of a given street and add the lengths
-                }
-                street_lengths[street].push_back(streetLength);                                                         //store street length in the vector
+// Rebuilds every derived container from the streets and OSM databases.
+// The phases run as a task graph: independent phases run side by side and the
+// per-element loops are split into chunks, so no single phase holds up the load.
+void buildMapData() {
+    //resizing the vectors to the appropriate size
+    street_street_segments.resize(getNumStreets());
+    street_segment_info.resize(getNumStreetSegments());
+    street_segment_length.resize(getNumStreetSegments());
+    street_lengths.resize(getNumStreets());
+    intersections_xyposname.resize(getNumIntersections());
+    streetSegmentIdx_point2dxyCurvepoints.resize(getNumStreetSegments());
+    Features.resize(getNumFeatures());
+    poi_information.resize(getNumPointsOfInterest());
+
+    TaskGraph loadGraph;
+    std::mutex reductionLock;
+
+    //Edge offsets of the intersection graph (streetGraph), filled in once segment info is loaded
+    TaskGraph::TaskId graphOffsets = loadGraph.addTask("street graph offsets", [](){
+        streetGraph.computeOffsets();
+    });
+
+    //Vector of streets segments with accompanying street segment info and lengths, plus the fastest speed limit
+    max_speed_limit = 0;
+    TaskGraph::TaskId segmentInfo = loadGraph.addParallelFor("segment info", 0, getNumStreetSegments(), loadGraph.chunkSizeFor(getNumStreetSegments()), [&reductionLock](int begin, int end){
+        float chunkMaxSpeed = 0;
+        for (int StreetSegment = begin; StreetSegment < end; StreetSegment++) {
+            street_segment_info[StreetSegment] = getStreetSegmentInfo(StreetSegment);           //store street segment info in vector
+            street_segment_length[StreetSegment] = findStreetSegmentLength(StreetSegment);      //store street segment length in vector (needs the info above)
+            chunkMaxSpeed = std::max(chunkMaxSpeed, street_segment_info[StreetSegment].speedLimit);
+        }
+        std::lock_guard<std::mutex> lock(reductionLock);
+        max_speed_limit = std::max(max_speed_limit, chunkMaxSpeed);
+    });
+
+    //Edges of every intersection with their targets and travel times (streetGraph)
+    TaskGraph::TaskId graphEdges = loadGraph.addParallelFor("street graph", 0, getNumIntersections(), loadGraph.chunkSizeFor(getNumIntersections()), [](int begin, int end){
+        streetGraph.fillEdges(begin, end);
+    }, {graphOffsets, segmentInfo});
+
+    //Segment traversals and the turns between them, the graph the routing searches run on (edgeBasedGraph)
+    loadGraph.addTask("edge-based graph", [](){
+        edgeBasedGraph.build();
+    }, {graphEdges});
+
+    //Landmark travel times for the ALT lower bounds (landmarkTable): the landmarks are picked one
+    //after another, then the backward searches to each of them run side by side
+    TaskGraph::TaskId landmarkSelection = loadGraph.addTask("landmark selection", [](){
+        landmarkTable.selectLandmarks();
+    }, {graphEdges});
+    loadGraph.addParallelFor("landmark tables", 0, LandmarkTable::kNumLandmarks, 1, [](int begin, int end){
+        landmarkTable.fillBackward(begin, end);
+    }, {landmarkSelection});
+
+    //Intersections projected for the A* heuristics (heuristicGeometry), needs the fastest speed limit
+    loadGraph.addTask("heuristic geometry", [](){
+        heuristicGeometry.build();
+    }, {segmentInfo});
+
+    //Vector of streets with accompanying street segments (street_street_segments)
+    TaskGraph::TaskId streetSegments = loadGraph.addTask("street segments", [](){
+        for (int streetSegment = 0; streetSegment < getNumStreetSegments(); ++streetSegment) {
+            street_street_segments[street_segment_info[streetSegment].streetID].push_back(streetSegment);
+        }
+    }, {segmentInfo});
+
+    //Intersections of every street (streetIntersectionIndex) and street lengths (street_lengths)
+    std::vector<std::vector<IntersectionIdx>> intersectionsPerStreet(getNumStreets());
+    TaskGraph::TaskId streetIntersections = loadGraph.addParallelFor("street intersections", 0, getNumStreets(), loadGraph.chunkSizeFor(getNumStreets()), [&intersectionsPerStreet](int begin, int end){
+        for (int street = begin; street < end; ++street) {
+            double streetLength = 0;
+            for (StreetSegmentIdx segment : street_street_segments[street]) {
+                intersectionsPerStreet[street].push_back(street_segment_info[segment].from);
+                intersectionsPerStreet[street].push_back(street_segment_info[segment].to);
+                streetLength += street_segment_length[segment];
             }
-
-        }};
-
-        std::thread t4 {[](){
-             max_speed_limit = 0;
-            //Vector of streets segments with accompanying street segment info (street_segment_info)
-            //populating the street_segment_info nested vector with all street segments(+ their associated segment info)
-            for (int StreetSegment = 0; StreetSegment < getNumStreetSegments(); StreetSegment++) {
-                street_segment_info[StreetSegment] = getStreetSegmentInfo(StreetSegment);           //store street segment info in vector
-                street_segment_length[StreetSegment] = findStreetSegmentLength(StreetSegment);      //store street segment length in vector
-                
-                max_speed_limit = std::max(max_speed_limit, getStreetSegmentInfo(StreetSegment).speedLimit);
-                
+            street_lengths[street].push_back(streetLength);
+        }
+    }, {streetSegments});
+    loadGraph.addTask("street intersection index", [&intersectionsPerStreet](){
+        streetIntersectionIndex.build(intersectionsPerStreet);
+    }, {streetIntersections});
+
+    //map of osmID to key-tagvalue pair for nodes, collected per chunk and merged in node order
+    int nodeChunkSize = loadGraph.chunkSizeFor(getNumberOfNodes());
+    int numNodeChunks = (getNumberOfNodes() + nodeChunkSize - 1) / nodeChunkSize;
+    std::vector<OSMTagStore> nodeTagChunks(numNodeChunks);
+    std::vector<std::vector<int>> cityIndexChunks(numNodeChunks);
+    TaskGraph::TaskId nodeTags = loadGraph.addParallelFor("OSM node tags", 0, getNumberOfNodes(), nodeChunkSize, [&, nodeChunkSize](int begin, int end){
+        int chunk = begin / nodeChunkSize;
+        for (int nodeNumber = begin; nodeNumber < end; nodeNumber++) {
+            const OSMNode* node = getNodeByIndex(nodeNumber);
+            if (getTagCount(node) == 0) {
+                continue;
             }
-        }};
-
-        std::thread t6 {[](){
-            //map of osmID to key-tagvalue pair
-            for(int nodeNumber = 0; nodeNumber < getNumberOfNodes(); nodeNumber++){
-                std::vector <std::pair <std::string, std:: string>> vectorPairs;
-                for(int tagNumber = 0; tagNumber < getTagCount(getNodeByIndex(nodeNumber)); tagNumber++){
-                    vectorPairs.push_back( getTagPair(getNodeByIndex(nodeNumber), tagNumber));
-                    std::string key, tag;
-                    std::tie(key, tag) = getTagPair(getNodeByIndex(nodeNumber), tagNumber);
-                    std::pair <std::string, std::string> keyTagPair = getTagPair(getNodeByIndex(nodeNumber), tagNumber);
-                    //if the given node is of key place and tag city
-                    if (keyTagPair.first == "place" && keyTagPair.second == "city") {
-                        cityIndexes.push_back(nodeNumber);
-                    }
-
+            nodeTagChunks[chunk].beginEntity(node->id(), nodeNumber);
+            for (int tagNumber = 0; tagNumber < getTagCount(node); tagNumber++) {
+                std::pair<std::string, std::string> tag = getTagPair(node, tagNumber);
+                if (OSMNodesandTags.indexesKey(tag.first)) {
+                    nodeTagChunks[chunk].addTag(tag.first, tag.second);
                 }
-                OSMNodesandTags.insert(std::make_pair(getNodeByIndex(nodeNumber)->id(), vectorPairs));
-            }
-        }};
-        std::thread t7 {[](){
-            //populating hashmap of alphabetically ordered streedIDs via name
-            for(int street = 0; street < getNumStreets(); street++){
-                std::string streetName = getStreetName(street);
-                streetName.erase( std::remove( streetName.begin(), streetName.end(), ' ' ), streetName.end() );
-                streetName = toLowerString(streetName);
-                for(int letterIndex = 1; letterIndex <= streetName.size(); letterIndex++){
-                    if(std::find(allStreetsKeys[shortVersion(streetName, letterIndex)].begin(), allStreetsKeys[shortVersion(streetName, letterIndex)].end(), street) == allStreetsKeys[shortVersion(streetName, letterIndex)].end())
-                        allStreetsKeys[shortVersion(streetName, letterIndex)].push_back(street);
+                //if the given node is of key place and tag city
+                if (tag.first == "place" && tag.second == "city") {
+                    cityIndexChunks[chunk].push_back(nodeNumber);
                 }
-                
             }
-        }};
-        std::thread t8 {[](){
-            //M2 PREPROCESSING
-            max_lat = getIntersectionPosition(0).latitude();
-            min_lat = max_lat;
-            max_lon = getIntersectionPosition(0).longitude();
-            min_lon = max_lon;
-
-            
-            for (int intersectionID = 0; intersectionID < getNumIntersections(); ++intersectionID) {
-                intersections_xyposname[intersectionID].position = getIntersectionPosition(intersectionID);
-                intersections_xyposname[intersectionID].name = getIntersectionName(intersectionID);
-
-
-                max_lat = std::max(max_lat, getIntersectionPosition(intersectionID).latitude());
-                min_lat = std::min(min_lat, getIntersectionPosition(intersectionID).latitude());
-                max_lon = std::max(max_lon, getIntersectionPosition(intersectionID).longitude());
-                min_lon = std::min(min_lon, getIntersectionPosition(intersectionID).longitude());
-            }
-
-            avg_lat = (min_lat + max_lat)/2;
-
-            for (int intersectionID = 0; intersectionID < getNumIntersections(); ++intersectionID) {
-                double x = x_from_lon(getIntersectionPosition(intersectionID).longitude());
-                double y = y_from_lat(getIntersectionPosition(intersectionID).latitude());
-
-                intersections_xyposname[intersectionID].xy_loc = ezgl::point2d(x,y);
+        }
+    });
+    loadGraph.addTask("merge OSM node tags", [&](){
+        for (int chunk = 0; chunk < numNodeChunks; chunk++) {
+            OSMNodesandTags.append(nodeTagChunks[chunk]);
+            nodeTagChunks[chunk].clear();
+            cityIndexes.insert(cityIndexes.end(), cityIndexChunks[chunk].begin(), cityIndexChunks[chunk].end());
+        }
+        OSMNodesandTags.finish();
+    }, {nodeTags});
+
+    //map of osmID to key-tagvalue pair for ways
+    int wayChunkSize = loadGraph.chunkSizeFor(getNumberOfWays());
+    int numWayChunks = (getNumberOfWays() + wayChunkSize - 1) / wayChunkSize;
+    std::vector<OSMTagStore> wayTagChunks(numWayChunks);
+    TaskGraph::TaskId wayTags = loadGraph.addParallelFor("OSM way tags", 0, getNumberOfWays(), wayChunkSize, [&, wayChunkSize](int begin, int end){
+        int chunk = begin / wayChunkSize;
+        for (int wayNumber = begin; wayNumber < end; wayNumber++) {
+            const OSMWay* way = getWayByIndex(wayNumber);
+            if (getTagCount(way) == 0) {
+                continue;
             }
-        }};
-        t8.join();
-        std::thread t9 {[](){
-            //Vector of featurepoint IDs with all feature points in point2d x and y    
-            for(int featureID = 0; featureID < getNumFeatures(); ++featureID){
-                Features[featureID].max_x = x_from_lon(getFeaturePoint(featureID, 0).longitude());
-                Features[featureID].min_x = Features[featureID].max_x;
-                Features[featureID].max_y = y_from_lat(getFeaturePoint(featureID, 0).latitude());
-                Features[featureID].min_y = Features[featureID].max_y;
-                Features[featureID].area = findFeatureArea(featureID);
-                for(int featurePointNum = 0; featurePointNum < getNumFeaturePoints(featureID); ++featurePointNum){
-                    double x = x_from_lon(getFeaturePoint(featureID, featurePointNum).longitude());
-                    double y = y_from_lat(getFeaturePoint(featureID, featurePointNum).latitude());
-                    Features[featureID].featurePoints.push_back(ezgl::point2d(x,y));
-                    Features[featureID].numFeaturePoints = featurePointNum;
-                    Features[featureID].type = asString(getFeatureType(featureID));
-                    Features[featureID].max_x = std::max(Features[featureID].max_x, x);
-                    Features[featureID].min_x = std::min(Features[featureID].min_x, x);
-                    Features[featureID].max_y = std::max(Features[featureID].max_y, y);
-                    Features[featureID].min_y = std::min(Features[featureID].min_y, y);
+            wayTagChunks[chunk].beginEntity(way->id(), wayNumber);
+            for (int tagNumber = 0; tagNumber < getTagCount(way); tagNumber++) {
+                std::pair<std::string, std::string> tag = getTagPair(way, tagNumber);
+                if (OSMWaysandTags.indexesKey(tag.first)) {
+                    wayTagChunks[chunk].addTag(tag.first, tag.second);
                 }
             }
-            std::sort(Features.begin(), Features.end(), areaCompare);
-        }};
-        std::thread t10 {[](){
-            //Vector of street seg ids with curve points in point2dx
-            for(int streetSegmentID = 0; streetSegmentID < getNumStreetSegments(); ++streetSegmentID){
-                int num_curvepoints = street_segment_info[streetSegmentID].numCurvePoints;
-                LatLon  start_point = getIntersectionPosition(street_segment_info[streetSegmentID].from),
-                        end_point = getIntersectionPosition(street_segment_info[streetSegmentID].to);
-
-                
-                double x = x_from_lon(start_point.longitude());
-                double y = y_from_lat(start_point.latitude());
-                streetSegmentIdx_point2dxyCurvepoints[streetSegmentID].push_back(ezgl::point2d(x,y)); 
-            
-                
-                for (int curvePointNum = 0; curvePointNum < num_curvepoints; curvePointNum++) {
-                    x = x_from_lon(getStreetSegmentCurvePoint(streetSegmentID, curvePointNum).longitude());
-                    y = y_from_lat(getStreetSegmentCurvePoint(streetSegmentID, curvePointNum).latitude());
-                    streetSegmentIdx_point2dxyCurvepoints[streetSegmentID].push_back(ezgl::point2d(x,y)); 
-                }
-
-                x = x_from_lon(end_point.longitude());
-                y = y_from_lat(end_point.latitude());
-                streetSegmentIdx_point2dxyCurvepoints[streetSegmentID].push_back(ezgl::point2d(x,y));
-
+        }
+    });
+    loadGraph.addTask("merge OSM way tags", [&](){
+        for (int chunk = 0; chunk < numWayChunks; chunk++) {
+            OSMWaysandTags.append(wayTagChunks[chunk]);
+            wayTagChunks[chunk].clear();
+        }
+        OSMWaysandTags.finish();
+    }, {wayTags});
+
+    //populating hashmap of alphabetically ordered streedIDs via name
+    loadGraph.addTask("street name index", [](){
+        streetNameIndex.build();
+    });
+
+    //M2 PREPROCESSING: intersection positions, names and the map bounds that fix the projection
+    max_lat = getIntersectionPosition(0).latitude();
+    min_lat = max_lat;
+    max_lon = getIntersectionPosition(0).longitude();
+    min_lon = max_lon;
+    TaskGraph::TaskId intersectionBounds = loadGraph.addParallelFor("intersection bounds", 0, getNumIntersections(), loadGraph.chunkSizeFor(getNumIntersections()), [&reductionLock](int begin, int end){
+        //seed from the chunk's own first position; the globals are only touched under the lock
+        LatLon first = getIntersectionPosition(begin);
+        double chunkMaxLat = first.latitude(), chunkMinLat = chunkMaxLat;
+        double chunkMaxLon = first.longitude(), chunkMinLon = chunkMaxLon;
+        for (int intersectionID = begin; intersectionID < end; ++intersectionID) {
+            LatLon position = getIntersectionPosition(intersectionID);
+            intersections_xyposname[intersectionID].position = position;
+            intersections_xyposname[intersectionID].name = getIntersectionName(intersectionID);
+
+            chunkMaxLat = std::max(chunkMaxLat, position.latitude());
+            chunkMinLat = std::min(chunkMinLat, position.latitude());
+            chunkMaxLon = std::max(chunkMaxLon, position.longitude());
+            chunkMinLon = std::min(chunkMinLon, position.longitude());
+        }
+        std::lock_guard<std::mutex> lock(reductionLock);
+        max_lat = std::max(max_lat, chunkMaxLat);
+        min_lat = std::min(min_lat, chunkMinLat);
+        max_lon = std::max(max_lon, chunkMaxLon);
+        min_lon = std::min(min_lon, chunkMinLon);
+    });
+    //k-d tree over the intersection positions for the closest-intersection queries
+    loadGraph.addTask("intersection spatial index", [](){
+        std::vector<LatLon> positions(getNumIntersections());
+        for (int intersectionID = 0; intersectionID < getNumIntersections(); ++intersectionID) {
+            positions[intersectionID] = intersections_xyposname[intersectionID].position;
+        }
+        intersectionSpatialIndex.build(positions);
+    }, {intersectionBounds});
+    //everything projected to x/y needs avg_lat, so it waits on this task instead of a thread join
+    TaskGraph::TaskId projection = loadGraph.addTask("projection", [](){
+        avg_lat = (min_lat + max_lat)/2;
+    }, {intersectionBounds});
+
+    loadGraph.addParallelFor("intersection xy", 0, getNumIntersections(), loadGraph.chunkSizeFor(getNumIntersections()), [](int begin, int end){
+        for (int intersectionID = begin; intersectionID < end; ++intersectionID) {
+            double x = x_from_lon(intersections_xyposname[intersectionID].position.longitude());
+            double y = y_from_lat(intersections_xyposname[intersectionID].position.latitude());
+            intersections_xyposname[intersectionID].xy_loc = ezgl::point2d(x,y);
+        }
+    }, {projection});
+
+    //Vector of featurepoint IDs with all feature points in point2d x and y
+    TaskGraph::TaskId features = loadGraph.addParallelFor("features", 0, getNumFeatures(), loadGraph.chunkSizeFor(getNumFeatures()), [](int begin, int end){
+        for (int featureID = begin; featureID < end; ++featureID) {
+            Features[featureID].max_x = x_from_lon(getFeaturePoint(featureID, 0).longitude());
+            Features[featureID].min_x = Features[featureID].max_x;
+            Features[featureID].max_y = y_from_lat(getFeaturePoint(featureID, 0).latitude());
+            Features[featureID].min_y = Features[featureID].max_y;
+            Features[featureID].area = findFeatureArea(featureID);
+            for (int featurePointNum = 0; featurePointNum < getNumFeaturePoints(featureID); ++featurePointNum) {
+                double x = x_from_lon(getFeaturePoint(featureID, featurePointNum).longitude());
+                double y = y_from_lat(getFeaturePoint(featureID, featurePointNum).latitude());
+                Features[featureID].featurePoints.push_back(ezgl::point2d(x,y));
+                Features[featureID].numFeaturePoints = featurePointNum;
+                Features[featureID].type = asString(getFeatureType(featureID));
+                Features[featureID].max_x = std::max(Features[featureID].max_x, x);
+                Features[featureID].min_x = std::min(Features[featureID].min_x, x);
+                Features[featureID].max_y = std::max(Features[featureID].max_y, y);
+                Features[featureID].min_y = std::min(Features[featureID].min_y, y);
             }
-        }};
-        std::thread t11 {[](){
-            // initialize required poi data
-            int numPOIS = getNumPointsOfInterest();
-            poi_information.resize(numPOIS);
-
-            for (int poiID = 0; poiID < numPOIS; poiID++) {
-                poi_information[poiID].position = getPOIPosition(poiID);
+        }
+    }, {projection});
+    loadGraph.addTask("sort features", [](){
+        std::sort(Features.begin(), Features.end(), areaCompare);
+    }, {features});
+
+    //Vector of street seg ids with curve points in point2dx
+    loadGraph.addParallelFor("curve points", 0, getNumStreetSegments(), loadGraph.chunkSizeFor(getNumStreetSegments()), [](int begin, int end){
+        for (int streetSegmentID = begin; streetSegmentID < end; ++streetSegmentID) {
+            int num_curvepoints = street_segment_info[streetSegmentID].numCurvePoints;
+            LatLon  start_point = getIntersectionPosition(street_segment_info[streetSegmentID].from),
+                    end_point = getIntersectionPosition(street_segment_info[streetSegmentID].to);
+            std::vector <ezgl::point2d>& curvePoints = streetSegmentIdx_point2dxyCurvepoints[streetSegmentID];
+            curvePoints.reserve(num_curvepoints + 2);
+
+            curvePoints.push_back(ezgl::point2d(x_from_lon(start_point.longitude()), y_from_lat(start_point.latitude())));
+            for (int curvePointNum = 0; curvePointNum < num_curvepoints; curvePointNum++) {
+                LatLon curvePoint = getStreetSegmentCurvePoint(streetSegmentID, curvePointNum);
+                curvePoints.push_back(ezgl::point2d(x_from_lon(curvePoint.longitude()), y_from_lat(curvePoint.latitude())));
+            }
+            curvePoints.push_back(ezgl::point2d(x_from_lon(end_point.longitude()), y_from_lat(end_point.latitude())));
+        }
+    }, {projection, segmentInfo});
 
-                double x = x_from_lon(poi_information[poiID].position.longitude());
-                double y = y_from_lat(poi_information[poiID].position.latitude());
+    // initialize required poi data
+    loadGraph.addParallelFor("POIs", 0, getNumPointsOfInterest(), loadGraph.chunkSizeFor(getNumPointsOfInterest()), [](int begin, int end){
+        for (int poiID = begin; poiID < end; poiID++) {
+            poi_information[poiID].position = getPOIPosition(poiID);
 
-                poi_information[poiID].xy_loc = ezgl::point2d(x,y);
+            double x = x_from_lon(poi_information[poiID].position.longitude());
+            double y = y_from_lat(poi_information[poiID].position.latitude());
 
-                poi_information[poiID].name = getPOIName(poiID);
-                
-                //poi_information[poiID].type = getPOIType(poiID);
-                sortPOITypes(getPOIType(poiID), poiID);
-                    
-            }
-        }};
-        std::thread t12 {[](){
-            //map of osmID to key-tagvalue pair
-            for(int wayNumber = 0; wayNumber < getNumberOfWays(); wayNumber++){
-                std::vector <std::pair <std::string, std:: string>> vectorPairs;
-                for(int tagNumber = 0; tagNumber < getTagCount(getWayByIndex(wayNumber)); tagNumber++){
-                    vectorPairs.push_back( getTagPair(getWayByIndex(wayNumber), tagNumber));
-                }
-                OSMWaysandTags.insert(std::make_pair(getWayByIndex(wayNumber)->id(), vectorPairs));
-            }
-        }};
-        t1.join();
-        t2.join();
-        t4.join();
-        t6.join();
-        t7.join();
-        t9.join();
-        t10.join();
-        t11.join();
-        t12.join();
+            poi_information[poiID].xy_loc = ezgl::point2d(x,y);
+            poi_information[poiID].name = getPOIName(poiID);
+            sortPOITypes(getPOIType(poiID), poiID);
+        }
+    }, {projection});
+    //poi_information only keeps the coarse drawing category, so bucket on the raw database type
+    loadGraph.addTask("POI spatial index", [](){
+        std::vector<LatLon> positions(getNumPointsOfInterest());
+        std::vector<std::string> types(getNumPointsOfInterest());
+        for (int poiID = 0; poiID < getNumPointsOfInterest(); poiID++) {
+            positions[poiID] = getPOIPosition(poiID);
+            types[poiID] = getPOIType(poiID);
+        }
+        poiSpatialIndex.build(positions, types);
+    });
 
-    }
-    auto currTime = std::chrono::high_resolution_clock::now();
-    auto wallClock = std::chrono::duration_cast<std::chrono::duration<double>>(currTime - startTime);
-    std::cout << "Load Map: " << wallClock.count() << std::endl;
-    return load_successful;
+    loadGraph.run();
+    loadProfile.addTaskGraph(loadGraph);
 }
 
 void closeMap() {
@@ -355,14 +452,19 @@ void closeMap() {
     closeStreetDatabase();
     closeOSMDatabase();
     
-    intersection_street_segments.clear();           //clearing vectors used by loadMap and functions
-    street_intersections.clear();
+    contractionHierarchies.clear();                 //hierarchies are built from edgeBasedGraph, drop them first
+    edgeBasedGraph.clear();
+    landmarkTable.clear();
+    streetGraph.clear();                            //clearing vectors used by loadMap and functions
+    streetIntersectionIndex.clear();
     street_street_segments.clear();
     street_lengths.clear();
     street_segment_length.clear();
     street_segment_info.clear();
     OSMNodesandTags.clear();
-    allStreetsKeys.clear();
+    streetNameIndex.clear();
+    intersectionSpatialIndex.clear();
+    poiSpatialIndex.clear();
     intersections_xyposname.clear();
     streetSegmentIdx_point2dxyCurvepoints.clear();
     OSMWaysandTags.clear();
@@ -370,7 +472,11 @@ void closeMap() {
     cityIndexes.clear();
     poi_information.clear();
     pathGlobalBool.clear();
-    nodes.clear();
+    heuristicGeometry.clear();
+    //other threads' contexts resize themselves for the next map
+    threadRoutingContext().clear();
+    releaseRoutingContextPool();
+    routeCache.invalidate();
 }
 
 
@@ -445,27 +551,11 @@ double findStreetSegmentTravelTime(StreetSegmentIdx street_segment_id) {
 std::vector<IntersectionIdx> findAdjacentIntersections(IntersectionIdx intersection_id) {
     std::vector<IntersectionIdx> AdjacentIntersections;
     
-    //iterating over all the street segments associated with a given intersection (extracted from intersection_street_segments vector)
-    for(int streetSegmentNum = 0; streetSegmentNum < intersection_street_segments[intersection_id].size(); streetSegmentNum++){
-        StreetSegmentInfo street_segment = getStreetSegmentInfo(intersection_street_segments[intersection_id][streetSegmentNum]);
-        
-        if(street_segment.oneWay != true){                                                                                                      
-            //if the current street segment is not a one way, store either the "from" or "to" intersection (dependent on which is equal to the given intersection_id) in the return vector
-            if(street_segment.from != intersection_id){
-                if(std::find(AdjacentIntersections.begin(), AdjacentIntersections.end(), street_segment.from) == AdjacentIntersections.end()) 
-                    AdjacentIntersections.push_back(street_segment.from);
-            } else if (street_segment.to != intersection_id){
-                if(std::find(AdjacentIntersections.begin(), AdjacentIntersections.end(), street_segment.to) == AdjacentIntersections.end())
-                    AdjacentIntersections.push_back(street_segment.to);
-            } else {
-                if(std::find(AdjacentIntersections.begin(), AdjacentIntersections.end(), street_segment.from) == AdjacentIntersections.end())
-                    AdjacentIntersections.push_back(street_segment.from);
-            }
-
-            //if the current street segment is a one way, store the "to" intersection 
-        } else if(street_segment.to != intersection_id){
-            if(std::find(AdjacentIntersections.begin(), AdjacentIntersections.end(), street_segment.to) == AdjacentIntersections.end())
-                AdjacentIntersections.push_back(street_segment.to);
+    //iterating over all the street segments associated with a given intersection (edges of the intersection in streetGraph)
+    for(const StreetGraphEdge& edge : streetGraph.edgesOf(intersection_id)){
+        //one-way segments can only be travelled from their "from" intersection
+        if(edge.traversable && std::find(AdjacentIntersections.begin(), AdjacentIntersections.end(), edge.to) == AdjacentIntersections.end()){
+            AdjacentIntersections.push_back(edge.to);
         }
     }
     return AdjacentIntersections;
@@ -473,29 +563,30 @@ std::vector<IntersectionIdx> findAdjacentIntersections(IntersectionIdx intersect
 
 // Returns tPOItypeuirement --> none
 IntersectionIdx findClosestIntersection(LatLon my_position) {
-    
-    double minDistance = kEarthRadiusInMeters;
-    IntersectionIdx minDistanceIntersection = 0;
-
-    //iterate over all the intersections in the map - track the smallest distance using minDistance and minDistanceIntersection
-    for(int intersection = 0; intersection < getNumIntersections(); intersection++){
-        double distance = 0;
-        LatLon intersectionPosition = getIntersectionPosition(intersection);
-        distance = findDistanceBetweenTwoPoints(intersectionPosition, my_position);
-        if(distance <= minDistance){
-            minDistance = distance;
-            minDistanceIntersection = intersection;
-        }
 
-    }
+    //exact nearest in the findDistanceBetweenTwoPoints metric (ties go to the larger id, as the old linear scan did)
+    return std::max(intersectionSpatialIndex.nearest(my_position), 0);
+}
+
+// Returns the k intersections closest to the given position, closest first
+std::vector<IntersectionIdx> findClosestIntersections(LatLon my_position, int k) {
+    return intersectionSpatialIndex.kNearest(my_position, std::max(k, 0));
+}
 
-    return minDistanceIntersection;
+// Returns every intersection within radius metres of the given position, closest first
+std::vector<IntersectionIdx> findIntersectionsWithinRadius(LatLon my_position, double radius) {
+    return intersectionSpatialIndex.withinRadius(my_position, radius);
 }
 
 // Returns the street segments that connect to the given intersection 
 // Speed Requirement --> high
 std::vector<StreetSegmentIdx> findStreetSegmentsOfIntersection(IntersectionIdx intersection_id) {
-    return intersection_street_segments[intersection_id];
+    std::vector<StreetSegmentIdx> streetSegments;
+    streetSegments.reserve(streetGraph.edgesOf(intersection_id).size());
+    for(const StreetGraphEdge& edge : streetGraph.edgesOf(intersection_id)){
+        streetSegments.push_back(edge.segment);
+    }
+    return streetSegments;
 }
 
 // Returns all intersections along the given street.
@@ -503,9 +594,8 @@ std::vector<StreetSegmentIdx> findStreetSegmentsOfIntersection(IntersectionIdx i
 // Speed Requirement --> high
 std::vector<IntersectionIdx> findIntersectionsOfStreet(StreetIdx street_id) {
 
-    std::vector <IntersectionIdx> street_intersections_vector(street_intersections[street_id].begin(), street_intersections[street_id].end());
-    
-    return street_intersections_vector;
+    IntersectionRange intersections = streetIntersectionIndex.intersectionsOf(street_id);
+    return std::vector<IntersectionIdx>(intersections.begin(), intersections.end());
 }
 
 // Return all intersection ids at which the two given streets intersect
@@ -516,17 +606,10 @@ std::vector<IntersectionIdx> findIntersectionsOfStreet(StreetIdx street_id) {
 // There should be no duplicate intersections in the returned vector.
 // Speed Requirement --> high
 std::vector<IntersectionIdx> findIntersectionsOfTwoStreets(StreetIdx street_id1, StreetIdx street_id2) {
-    std::vector <IntersectionIdx> street1Vector(street_intersections[street_id1].begin(), street_intersections[street_id1].end());
-    std::vector <IntersectionIdx> street2Vector(street_intersections[street_id2].begin(), street_intersections[street_id2].end());
     std::vector<IntersectionIdx> commonIntersections;
-    
-    //iterate through the street1 - for each intersection determine if the same intersection_id exists in street2
-    for (int intersection = 0; intersection < street1Vector.size(); ++intersection) {
-        int commonIntersection = street1Vector[intersection];
-        if (std::find(street2Vector.begin(), street2Vector.end(), commonIntersection) != street2Vector.end()) {
-            commonIntersections.push_back(commonIntersection);
-        }
-    }
+
+    //both runs are sorted, so a linear merge (or a galloping search when one street is much longer) finds the common ones
+    streetIntersectionIndex.appendCommonIntersections(street_id1, street_id2, commonIntersections);
 
     return commonIntersections;
 }
@@ -543,29 +626,15 @@ std::vector<IntersectionIdx> findIntersectionsOfTwoStreets(StreetIdx street_id1,
 // (length 0) string, but your program must not crash if street_prefix is a 
 // length 0 string.
 // Speed Requirement --> high 
-std::string toLowerString(std::string street_prefix){
-    
-    for(int letterIndex = 0; letterIndex < street_prefix.size(); letterIndex++){
-        street_prefix[letterIndex] = tolower(street_prefix[letterIndex]);
-    }
-    return street_prefix;
-}
-std::string shortVersion(std::string input, int size){
-    input.resize(size);
-    return input;
-}
 std::vector<StreetIdx> findStreetIdsFromPartialStreetName(std::string street_prefix) {
 
-    if(street_prefix.size() == 0){
-        std::vector<StreetIdx> emptyVector= {};
-        return emptyVector;
-    }
-    
-    street_prefix.erase( std::remove( street_prefix.begin(), street_prefix.end(), ' ' ), street_prefix.end() );
-    street_prefix = toLowerString(street_prefix);
+    return streetNameIndex.streetsWithPrefix(StreetNameIndex::normalize(street_prefix));
+}
+
+// Same as above but returns at most maxResults streets, alphabetically first names first
+std::vector<StreetIdx> findStreetIdsFromPartialStreetName(std::string street_prefix, int maxResults) {
 
-    return allStreetsKeys[street_prefix];
-  
+    return streetNameIndex.streetsWithPrefix(StreetNameIndex::normalize(street_prefix), std::max(maxResults, 0));
 }
 
 // Returns the length of a given street in meters
@@ -579,25 +648,18 @@ double findStreetLength(StreetIdx street_id) {
 // Speed Requirement --> none 
 POIIdx findClosestPOI(LatLon my_position, std::string POItype) {
 
-    std::string type;
-    double smallestDistance = kEarthRadiusInMeters;
-    double currentDistance;
-    POIIdx closestPOI = 0;
-
-    //iterate through all points of interest - store smallest distance between current position and POI in smallest distance & closestPOI
-    for (POIIdx currentPOI = 0; currentPOI < getNumPointsOfInterest(); ++currentPOI) {
-        type = getPOIType(currentPOI);
-        if (type == POItype) {
-            currentDistance = findDistanceBetweenTwoPoints(getPOIPosition(currentPOI), my_position);
-            if (currentDistance <= smallestDistance) {
-                smallestDistance = currentDistance;
-                closestPOI = currentPOI;
-            }
-        }
-        
-    }
+    //only the k-d tree of the requested type is searched; 0 when no POI has that type, as before
+    return std::max(poiSpatialIndex.nearest(my_position, POItype), 0);
+}
 
-    return closestPOI;
+// Returns the k points of interest of the given type closest to the given position, closest first
+std::vector<POIIdx> findClosestPOIs(LatLon my_position, std::string POItype, int k) {
+    return poiSpatialIndex.kNearest(my_position, POItype, std::max(k, 0));
+}
+
+// Returns every point of interest of the given type within radius metres of the given position, closest first
+std::vector<POIIdx> findPOIsWithinRadius(LatLon my_position, std::string POItype, double radius) {
+    return poiSpatialIndex.withinRadius(my_position, POItype, radius);
 }
 
 // Returns the area of the given closed feature in square meters
@@ -667,30 +729,17 @@ double findFeatureArea(FeatureIdx feature_id) {
 // Speed Requirement --> high
 std::string getOSMNodeTagValue (OSMID OSMid, std::string key) {
 
-    std::vector <std::pair <std::string , std::string>>  vectorPairs =  OSMNodesandTags[OSMid];
-
-    for(int pairs = 0; pairs < vectorPairs.size(); pairs++){
-        if(vectorPairs[pairs].first == key){
-            return vectorPairs[pairs].second;
-        }
-    }
-    return "";
+    return std::string(OSMNodesandTags.value(OSMid, key));
 }
 
 // Return the value associated with this key on the specified OSMWay.
 // If this OSMWay does not exist in the current map, or the specified key is 
 // not set on the specified OSMNode, return an empty string.
+// The view points into the tag store and stays valid until closeMap.
 // Speed Requirement --> high
-std::string getOSMWayTagValue (OSMID OSMid, std::string key) {
-
-    std::vector <std::pair <std::string , std::string>>  vectorPairs =  OSMWaysandTags[OSMid];
+std::string_view getOSMWayTagValue (OSMID OSMid, std::string_view key) {
 
-    for(int pairs = 0; pairs < vectorPairs.size(); pairs++){
-        if(vectorPairs[pairs].first == key){
-            return vectorPairs[pairs].second;
-        }
-    }
-    return "";
+    return OSMWaysandTags.value(OSMid, key);
 }
 
 double x_from_lon(float lon) {
@@ -25,6 +25,7 @@
 #include "StreetsDatabaseAPI.h"
 #include "OSMDatabaseAPI.h"
 #include "samiristhegoat.h"
+#include "streetIndex.h"
 #include "ezgl/application.hpp"
 #include "ezgl/graphics.hpp"
 #include <cmath>
@@ -63,7 +64,7 @@ void toggle_help (GtkWidget* /*widget*/, ezgl::application* application);
 void deactivatePOIS();
 void displayCityNames(ezgl::renderer *g);
 void autoComplete(ezgl::application* application);
-void setDrawDetails(ezgl::renderer *g, std::string tag, double zoomFactorGlobal, int& red, int& green, int& blue);
+void setDrawDetails(ezgl::renderer *g, std::string_view tag, double zoomFactorGlobal, int& red, int& green, int& blue);
 
 void load_closure();
 void compile_closure_info(ptree &ptRoot);
@@ -189,7 +190,7 @@ void act_on_mouse_click(ezgl::application *app, GdkEventButton*, double x, doubl
       pairOfIntersections.first = firstIntersectionID;
       pairOfIntersections.second = id;
       
-      pathGlobal = findPathBetweenIntersections(pairOfIntersections, 15);
+      pathGlobal = findDisplayedPath(pairOfIntersections, 15);
       if (pathGlobal.size() == 0) {
          stringstream output;
 
@@ -339,7 +340,8 @@ void toggle_find_path(GtkWidget* /*widget*/, ezgl::application* application){
    //if both unique results found, highlight intersection
    for(int street1 = 0; street1 < partialMatchesVector1.size(); street1++) {
       for(int street2 = 0; street2 < partialMatchesVector2.size(); street2++){
-          intersectionsOfStreets = findIntersectionsOfTwoStreets(partialMatchesVector1[street1], partialMatchesVector2[street2]);
+          intersectionsOfStreets.clear();
+          streetIntersectionIndex.appendCommonIntersections(partialMatchesVector1[street1], partialMatchesVector2[street2], intersectionsOfStreets);
 
          for (int intersection = 0; intersection < intersectionsOfStreets.size(); intersection++){
            sourceIntersectionIDs.push_back(intersectionsOfStreets[intersection]);
@@ -348,7 +350,8 @@ void toggle_find_path(GtkWidget* /*widget*/, ezgl::application* application){
    }
    for(int street3 = 0; street3 < partialMatchesVector3.size(); street3++) {
       for(int street4 = 0; street4 < partialMatchesVector4.size(); street4++){
-          intersectionsOfStreets = findIntersectionsOfTwoStreets(partialMatchesVector3[street3], partialMatchesVector4[street4]);
+          intersectionsOfStreets.clear();
+          streetIntersectionIndex.appendCommonIntersections(partialMatchesVector3[street3], partialMatchesVector4[street4], intersectionsOfStreets);
 
          for (int intersection = 0; intersection < intersectionsOfStreets.size(); intersection++){
             destinationIntersectionIDs.push_back(intersectionsOfStreets[intersection]);
@@ -379,7 +382,7 @@ void toggle_find_path(GtkWidget* /*widget*/, ezgl::application* application){
       pairOfIntersections.first = srcID;
       pairOfIntersections.second = destID;
 
-      pathGlobal = findPathBetweenIntersections(pairOfIntersections, 15);
+      pathGlobal = findDisplayedPath(pairOfIntersections, 15);
       if (pathGlobal.size() == 0) {
          stringstream output;
          output << "No path exists between the given intersections: " << endl;
@@ -493,7 +496,8 @@ void toggle_find (GtkWidget* /*widget*/, ezgl::application* application) {
    //if both unique results found, highlight intersection
    for(int street1 = 0; street1 < partialMatchesVector1.size(); street1++) {
       for(int street2 = 0; street2 < partialMatchesVector2.size(); street2++){
-          intersectionsOfStreets = findIntersectionsOfTwoStreets(partialMatchesVector1[street1], partialMatchesVector2[street2]);
+          intersectionsOfStreets.clear();
+          streetIntersectionIndex.appendCommonIntersections(partialMatchesVector1[street1], partialMatchesVector2[street2], intersectionsOfStreets);
 
          for (int intersection = 0; intersection < intersectionsOfStreets.size(); intersection++){
             foundIntersection = true;
@@ -628,7 +632,7 @@ void displayStreets(ezgl::renderer *g){
       if (visibleWorld.contains(fromIntersectionPos) || visibleWorld.contains(toIntersectionPos) || visibleWorld.contains(midPoint)) {
          OSMID streetOSMID = street_segment_info[StrSegID].wayOSMID;
          std::string key = "highway";
-         std::string tag = getOSMWayTagValue(streetOSMID, key);
+         std::string_view tag = getOSMWayTagValue(streetOSMID, key);
          setDrawDetails(g, tag, zoomFactor, redColor, greenColor, blueColor);
          std::string streetName = getStreetName(street_segment_info[StrSegID].streetID);
 
@@ -713,7 +717,7 @@ void displayStreets(ezgl::renderer *g){
       if (visibleWorldForPath.contains(fromIntersectionPosPath) || visibleWorldForPath.contains(toIntersectionPosPath) || visibleWorldForPath.contains(midPointPath)) {
          OSMID streetOSMID = street_segment_info[streetSegID].wayOSMID;
          std::string key = "highway";
-         std::string tag = getOSMWayTagValue(streetOSMID, key);
+         std::string_view tag = getOSMWayTagValue(streetOSMID, key);
          setDrawDetails(g, tag, zoomFactor, redColor, greenColor, blueColor);
          std::string streetName = getStreetName(street_segment_info[streetSegID].streetID);
 
@@ -772,7 +776,7 @@ void displayStreets(ezgl::renderer *g){
    }
 }
 
-void setDrawDetails(ezgl::renderer *g, std::string tag, double zoomFactorGlobal, int& red, int& green, int& blue) {
+void setDrawDetails(ezgl::renderer *g, std::string_view tag, double zoomFactorGlobal, int& red, int& green, int& blue) {
    g->set_color(255, 255, 255);
    red = 255;
    green = 255;
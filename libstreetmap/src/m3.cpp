@@ -25,24 +25,30 @@
 #include "StreetsDatabaseAPI.h"
 #include "OSMDatabaseAPI.h"
 #include "samiristhegoat.h"
+#include "edgeBasedGraph.h"
+#include "routingContext.h"
+#include "routeCache.h"
 #include "ezgl/application.hpp"
 #include "ezgl/graphics.hpp"
 #include "ezgl/point.hpp"
 #include <cmath>
+#include <cstdlib>
 #include "libcurlstuff.h"
 
 #define _USE_MATH_DEFINES
-bool bfsPath(int srcID, int destID, const double turn_penalty);
-std::vector <StreetSegmentIdx> bfsTraceBack (int destID);
 int crossProduct(ezgl::point2d preLinkPointPos, ezgl::point2d linkIntersectionPos, ezgl::point2d nextPointPos);
 std::string determineTurnDirection(StreetSegmentInfo currentStreetSegment, StreetSegmentInfo prevStreetSegment, StreetSegmentIdx currentStreetSegmentID, StreetSegmentIdx prevStreetSegmentID);
 void displayPathMarkers(IntersectionIdx destID, IntersectionIdx srcID, ezgl::renderer *g);
 std::stringstream directionsText;
 bool newPath;
 
+//endpoints of the path on display, set by findDisplayedPath
 IntersectionIdx globalsrcID = 0;
 IntersectionIdx globaldestID = 0;
-//Vector of Node structs for each intersection
+RoutingEngine routingEngineFromEnvironment();
+//engine behind findPathBetweenIntersections, MAPPER_ROUTING_ENGINE=alt selects A* with landmarks,
+//bidir bidirectional A* and ch Contraction Hierarchies; set it before routing from several threads
+RoutingEngine routingEngine = routingEngineFromEnvironment();
 
 // Returns the time required to travel along the path specified, in seconds.
 // The path is given as a vector of street segment ids, and this function can
@@ -84,115 +90,48 @@ double computePathTravelTime(const std::vector<StreetSegmentIdx>& path, const do
 // of street segment ids; traversing these street segments, in the returned
 // order, would take one from the start to the destination intersection.
 std::vector<StreetSegmentIdx> findPathBetweenIntersections(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty){
-
+    CachedRoute route;
+    if(routeCache.find(intersect_ids.first, intersect_ids.second, turn_penalty, route)){
+        return route.path;
+    }
+    //each thread searches in its own context, so concurrent queries never share scratch
+    route.path = threadRoutingContext().findPath(intersect_ids.first, intersect_ids.second, turn_penalty, routingEngine);
+    route.travelTime = computePathTravelTime(route.path, turn_penalty);
+    routeCache.insert(intersect_ids.first, intersect_ids.second, turn_penalty, route);
+    return route.path;
+}
+//Same as findPathBetweenIntersections, but remembers the endpoints for displayPath's markers
+std::vector<StreetSegmentIdx> findDisplayedPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty){
     newPath = true;
-    //Setting all nodes best times to a large number
-    for(int nodeIntersection = 0; nodeIntersection < getNumIntersections(); nodeIntersection++){
-        nodes[nodeIntersection].bestTime = BIGNUMBER;
+    globalsrcID = intersect_ids.first;
+    globaldestID = intersect_ids.second;
+    return findPathBetweenIntersections(intersect_ids, turn_penalty);
+}
+RoutingEngine routingEngineFromEnvironment(){
+    const char* engine = std::getenv("MAPPER_ROUTING_ENGINE");
+    if(engine != nullptr && std::string(engine) == "ch"){
+        return RoutingEngine::ContractionHierarchies;
     }
-    IntersectionIdx srcID = intersect_ids.first;
-    IntersectionIdx destID = intersect_ids.second;
-    globalsrcID = srcID;
-    globaldestID = destID;
-    //Initializing Path as an Empty Vector
-    std::vector <StreetSegmentIdx> Path = {};
-    if(bfsPath(srcID, destID, turn_penalty)){
-        Path = bfsTraceBack(destID);
+    if(engine != nullptr && std::string(engine) == "bidir"){
+        return RoutingEngine::BidirectionalAStar;
     }
-    
-    return Path;
+    if(engine != nullptr && std::string(engine) == "alt"){
+        return RoutingEngine::ALT;
+    }
+    return RoutingEngine::AStar;
 }
-bool bfsPath(int srcID, int destID, const double turn_penalty){
-    //priority queue/ min heap
-    std::priority_queue<WaveElem, std::vector<WaveElem>, timeWaveElemComparator> waveFrontMinHeap; 
-    //Initializing source node
-    waveFrontMinHeap.push(WaveElem(srcID, SOURCE_EDGE, 0,0));
-    bool pathFound = false;
-    //While heap is empty
-    while(waveFrontMinHeap.size() != 0){
-        //take top of heap and pop it
-        WaveElem wave = waveFrontMinHeap.top();
-        waveFrontMinHeap.pop();
-        
-        int currNodeID = wave.nodeID;
-        //if the node im on has a faster time than its best time 
-        if(wave.travelTime < nodes[currNodeID].bestTime){
-            nodes[currNodeID].reachingEdge = wave.edgeID;
-            nodes[currNodeID].bestTime = wave.travelTime;
-               
-            if(currNodeID == destID){
-                pathFound = true;
-                return pathFound;
-            }
-            //vector of all segments coming out of the current node
-            std::vector<StreetSegmentIdx> outEdge = findStreetSegmentsOfIntersection(currNodeID);
-            //for loop looping through all of segments
-            for(int edge = 0; edge < outEdge.size(); edge++){
-                StreetSegmentInfo street_segment = street_segment_info[outEdge[edge]];
-                StreetSegmentInfo currNodeReachingEdge;
-                if(nodes[currNodeID].reachingEdge != SOURCE_EDGE){
-                    currNodeReachingEdge = street_segment_info[nodes[currNodeID].reachingEdge];
-                }
-                int toNodeID = 0;
-                if(street_segment.oneWay != true){
-                        if(currNodeID== street_segment.to){
-                            toNodeID = street_segment.from;
-                        } else {
-                            toNodeID = street_segment.to;
-                        }
-                        //calculating traveltime node and heuristic node
-                        double travelTimeNode = nodes[currNodeID].bestTime + findStreetSegmentTravelTime(outEdge[edge]);
-                        double asTheCrowFlies = (findDistanceBetweenTwoPoints(getIntersectionPosition(destID), getIntersectionPosition(toNodeID)) / max_speed_limit);
-                        if(nodes[currNodeID].reachingEdge != SOURCE_EDGE && street_segment.streetID != currNodeReachingEdge.streetID){
-                            waveFrontMinHeap.push(WaveElem(toNodeID, outEdge[edge], travelTimeNode + turn_penalty, travelTimeNode + turn_penalty + asTheCrowFlies));
-                        } else{
-                            waveFrontMinHeap.push(WaveElem(toNodeID, outEdge[edge], travelTimeNode, travelTimeNode + asTheCrowFlies));
-                        }
-                } else {
-                    if(street_segment.from == currNodeID){
-                        //calculating traveltime node and heuristic node
-                        double travelTimeNode = nodes[currNodeID].bestTime + findStreetSegmentTravelTime(outEdge[edge]);
-                        double asTheCrowFlies = (findDistanceBetweenTwoPoints(getIntersectionPosition(destID), getIntersectionPosition(street_segment.to)) / max_speed_limit);
-                        if(nodes[currNodeID].reachingEdge != SOURCE_EDGE && street_segment.streetID != currNodeReachingEdge.streetID){
-                            waveFrontMinHeap.push(WaveElem(street_segment.to, outEdge[edge], travelTimeNode + turn_penalty, travelTimeNode + turn_penalty + asTheCrowFlies));
-                        }else {
-                            waveFrontMinHeap.push(WaveElem(street_segment.to, outEdge[edge], travelTimeNode, travelTimeNode + asTheCrowFlies));
-                        }
-                    }
-                }
-            }
-            
-        }
 
-    }
-    return pathFound;
+void setRoutingEngine(RoutingEngine engine){
+    routingEngine = engine;
 }
 
 std::vector <StreetSegmentIdx> bfsTraceBack (int destID) {
-
-    std::list<StreetSegmentIdx> path;
-
-    int currNodeID = destID;
-
-    int prevEdge = nodes[currNodeID].reachingEdge;
-
-    //this while loops goes into nodes vector at destID and back tracks all previous edges until the previous edge of the source then returns a vector
-    while(prevEdge != SOURCE_EDGE){
-        
-        path.push_front(prevEdge);
-        StreetSegmentInfo street_segment = getStreetSegmentInfo(prevEdge);
-        if(currNodeID == street_segment.to){
-            currNodeID = street_segment.from;
-        }else{
-            currNodeID = street_segment.to;
-        }
-        prevEdge = nodes[currNodeID].reachingEdge;
-    }
-    std::vector <StreetSegmentIdx> outputVector(path.begin(), path.end());
-
-    return outputVector;
+    return threadRoutingContext().traceBack(destID);
 }
 
+std::vector <StreetSegmentIdx> bidirectionalPath(IntersectionIdx srcID, IntersectionIdx destID, const double turn_penalty){
+    return threadRoutingContext().findPath(srcID, destID, turn_penalty, RoutingEngine::BidirectionalAStar);
+}
 
 void displayPath(std::vector<StreetSegmentIdx> streetSegmentPathVector, ezgl::renderer *g) {
     directionsText.str("");
@@ -21,13 +21,13 @@
 #include "m1.h"
 #include "m3.h"
 #include "samiristhegoat.h"
+#include "routeMatrix.h"
+#include <algorithm>
+#include <limits>
 
-void multidestDijkstra(IntersectionIdx, float);
-void loadM4(const float turn_penalty, const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots);
-void closeM4();
-std::vector <StreetSegmentIdx> traceBack (int destID);
-std::unordered_map <IntersectionIdx, std::vector <CourierPath>> pathsMatrix;
-std::vector <IntersectionIdx> deliveryIntersections;
+void loadM4(RouteMatrix& matrix, const float turn_penalty, const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots, CourierMatrix& courier);
+double routeTime(const std::vector<int>& route, const CourierMatrix& courier);
+bool deliversInOrder(const std::vector<int>& route, const CourierMatrix& courier);
 
 // std::unordered_map <IntersectionIdx, bool> completedCheck;
 // std::unordered_map <IntersectionIdx, IntersectionIdx> dropOffpickUp;
@@ -76,335 +76,173 @@ std::vector <IntersectionIdx> deliveryIntersections;
 // If no valid route to make *all* the deliveries exists, this routine must
 // return an empty (size == 0) vector.
 std::vector<CourierSubPath> travelingCourier(const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots, const float turn_penalty){
-    
-    std::vector<CourierSubPath> result = {};
-    std::vector<CourierSubPath> finalResult;
-    double finalResultTime = BIGNUMBER;
 
-    loadM4(turn_penalty, deliveries, depots);
+    //the matrices belong to this call, so couriers can be planned on several threads
+    RouteMatrix matrix;
+    CourierMatrix courier;
+    loadM4(matrix, turn_penalty, deliveries, depots, courier);
+    const int numStops = courier.numStops();
+    const float unreachable = std::numeric_limits<float>::infinity();
 
-    //PASSES MODERATE TA
-    //while loop for perturbations
-    for(int multistart = 0; multistart < depots.size(); multistart++){
+    std::vector<int> bestRoute; //stop ids from the start depot to the end depot
+    double bestRouteTime = BIGNUMBER;
 
-        bool isDone = false;
+    //per stop: deliveries still to be picked up there, picked-up deliveries waiting to be dropped
+    //off there, and deliveries not picked up yet that block a drop-off there
+    std::vector<int> pickUpsLeft(numStops), dropOffsReady(numStops), dropOffsBlocked(numStops);
+    std::vector<char> pickedUp(deliveries.size()), droppedOff(deliveries.size());
+
+    //greedy nearest legal stop, started once from every depot
+    for(int multistart = 0; multistart < depots.size(); multistart++){
 
-        //initializing vector of bool structs for drop off and pick up
-        std::vector<DeliveryInfBool> deliveriesBool;
+        std::fill(pickUpsLeft.begin(), pickUpsLeft.end(), 0);
+        std::fill(dropOffsReady.begin(), dropOffsReady.end(), 0);
+        std::fill(dropOffsBlocked.begin(), dropOffsBlocked.end(), 0);
+        std::fill(pickedUp.begin(), pickedUp.end(), false);
+        std::fill(droppedOff.begin(), droppedOff.end(), false);
         for(int delivery = 0; delivery < deliveries.size(); delivery++){
-            DeliveryInfBool currentDelivery;
-            currentDelivery.pickUp = deliveries[delivery].pickUp;
-            currentDelivery.dropOff = deliveries[delivery].dropOff;
-            deliveriesBool.push_back(currentDelivery);
+            pickUpsLeft[courier.pickUpStops[delivery]]++;
+            dropOffsBlocked[courier.dropOffStops[delivery]]++;
         }
-
-        //start algorithm
-        //go from depot to nearest pickup
-        IntersectionIdx source; //store the current source intersection
-        IntersectionIdx p;
-
-        double bestTime = BIGNUMBER;
-
-        // for (int currentDepot = 0; currentDepot < depots.size(); currentDepot++) {
-        //     for (int currentDestination = 0; currentDestination < pathsMatrix[depots[currentDepot]].size(); currentDestination++) {
-        //         CourierPath depotPath = pathsMatrix[depots[currentDepot]][currentDestination];
-        //         CourierSubPath depotSubPath = pathsMatrix[depots[currentDepot]][currentDestination].courierSubPath;
-        //         if (depotPath.subPathTime < bestTime) { //update the storage variables if new fastest time is found
-        //             bestTime = depotPath.subPathTime;
-        //             p = depotSubPath.start_intersection; //p holds the depot to start from
-        //             continue;
-        //         }
-        //     }
-        // }
-        p = depots[multistart];
-
-        CourierSubPath solutionSubPath; //stores the subpaths that will be put into result vector
-        CourierPath solutionPath;
-
-        while(!isDone){
-            source = p; 
-            bestTime = BIGNUMBER;
-            
-            for(int i = 0; i < pathsMatrix[source].size(); i++){
-                CourierPath currentElement = pathsMatrix[source][i];
-                CourierSubPath currentSubPath = pathsMatrix[source][i].courierSubPath;
-                IntersectionIdx destination = currentSubPath.end_intersection;
-                if(currentElement.destType == "depot"){
-                    continue;
-                } else if(currentElement.destType == "pickUp"){
-                    for(int j = 0; j < deliveriesBool.size(); j++){
-                        if(deliveriesBool[j].pickUp == destination && deliveriesBool[j].pickUpBool == false){
-                            if (currentElement.subPathTime < bestTime){    
-                                bestTime = currentElement.subPathTime;
-                                p = currentSubPath.end_intersection;
-                                solutionSubPath = currentSubPath;
-                                solutionPath = currentElement;
-                            }
-                        }
-                    }
-                } else {
-                    bool allPickedUp = true;
-                    for(int k = 0; k < deliveriesBool.size(); k++){
-                        if(deliveriesBool[k].dropOff == destination){
-                            if(deliveriesBool[k].pickUpBool == false){
-                                allPickedUp = false;
-                            }
-                        }
-                    }
-                    for(int j = 0; j < deliveriesBool.size(); j++){
-                        if(deliveriesBool[j].pickUpBool == true && deliveriesBool[j].dropOff == destination && deliveriesBool[j].dropOffBool == false && allPickedUp){
-                            if (currentElement.subPathTime < bestTime) {    
-                                bestTime = currentElement.subPathTime;
-                                p = currentSubPath.end_intersection;
-                                solutionSubPath = currentSubPath;
-                                solutionPath = currentElement;
-                            }
-                        }
-                    }
+        int deliveriesLeft = deliveries.size();
+
+        std::vector<int> route = {courier.depotStops[multistart]};
+        int current = route.back();
+        bool stuck = false;
+
+        while(deliveriesLeft > 0){
+            //only contiguous rows are scanned: a pick-up with parcels left, or a drop-off
+            //whose parcels are all on board
+            const float* timesFromCurrent = courier.timesFrom(current);
+            int next = -1;
+            float bestTime = unreachable;
+            for(int stop = 0; stop < numStops; stop++){
+                bool legal = pickUpsLeft[stop] > 0 || (dropOffsReady[stop] > 0 && dropOffsBlocked[stop] == 0);
+                if(legal && stop != current && timesFromCurrent[stop] < bestTime){
+                    bestTime = timesFromCurrent[stop];
+                    next = stop;
                 }
             }
-            for(int j = 0; j < deliveriesBool.size(); j++){
-                if(deliveriesBool[j].pickUp == p){
-                    deliveriesBool[j].pickUpBool = true;
-                }
-                if(deliveriesBool[j].pickUpBool == true && deliveriesBool[j].dropOff == p){
-                    deliveriesBool[j].dropOffBool = true;
-                }
+            if(next < 0){ //the remaining stops cannot be reached from here
+                stuck = true;
+                break;
             }
-            result.push_back(solutionSubPath); //add chosen sub path to the solution vector
-            isDone = true;
-            for(int j = 0; j < deliveriesBool.size(); j++){
-                if(deliveriesBool[j].dropOffBool == false){
-                    isDone = false;
+            for(int delivery = 0; delivery < deliveries.size(); delivery++){
+                if(!pickedUp[delivery] && courier.pickUpStops[delivery] == next){
+                    pickedUp[delivery] = true;
+                    pickUpsLeft[next]--;
+                    dropOffsBlocked[courier.dropOffStops[delivery]]--;
+                    dropOffsReady[courier.dropOffStops[delivery]]++;
                 }
-            }
-        }
-        //go to nearest depot
-        bestTime = BIGNUMBER;
-        for (int currentDestination = 0; currentDestination < pathsMatrix[p].size(); currentDestination++) {
-            CourierPath currentElement = pathsMatrix[p][currentDestination];
-            CourierSubPath currentSubPath = pathsMatrix[p][currentDestination].courierSubPath;
-            if (!(currentElement.destType == "depot")){
-                continue;
-            } else {
-                if (currentElement.subPathTime < bestTime) {    
-                    bestTime = currentElement.subPathTime;
-                    solutionSubPath = currentSubPath;
+                if(pickedUp[delivery] && !droppedOff[delivery] && courier.dropOffStops[delivery] == next){
+                    droppedOff[delivery] = true;
+                    dropOffsReady[next]--;
+                    deliveriesLeft--;
                 }
             }
+            route.push_back(next);
+            current = next;
         }
-        result.push_back(solutionSubPath); //add chosen sub path to the solution vector
-        
-        double resultTime = 0;
-        for(int resultSubPath = 0; resultSubPath < result.size(); resultSubPath++){
-            resultTime += computePathTravelTime(result[resultSubPath].subpath, turn_penalty);
-        }
-        if(resultTime < finalResultTime){
-            finalResult = result;
+        if(stuck){
+            continue;
         }
 
-        bool oneBoost = false;
-        int numSubPaths = result.size();
-        int i = 1;
-        while (!oneBoost) {
-            if (numSubPaths <= 3) continue;
-
-            //swapping 
-            CourierSubPath temp = result[numSubPaths - i];
-            result[numSubPaths - i] = result[numSubPaths - i - 1];
-            result[numSubPaths - i - 1] = temp;
-            
-            resultTime = 0;
-            for(int resultSubPath = 0; resultSubPath < result.size(); resultSubPath++){
-                resultTime += computePathTravelTime(result[resultSubPath].subpath, turn_penalty);
+        //go to nearest depot
+        int endDepot = -1;
+        float bestTime = unreachable;
+        const float* timesFromCurrent = courier.timesFrom(current);
+        for(int stop = 0; stop < numStops; stop++){
+            if((courier.roles[stop] & DepotStop) && timesFromCurrent[stop] < bestTime){
+                bestTime = timesFromCurrent[stop];
+                endDepot = stop;
             }
-
-            if(resultTime < finalResultTime){
-                finalResult = result;
-                oneBoost = true;
+        }
+        if(endDepot < 0){
+            continue;
+        }
+        route.push_back(endDepot);
+
+        //try visiting the last two stops the other way round
+        double resultTime = routeTime(route, courier);
+        if(route.size() > 3){
+            std::vector<int> swapped = route;
+            int last = swapped.size() - 2;
+            std::swap(swapped[last], swapped[last - 1]);
+            double swappedTime = routeTime(swapped, courier);
+            if(swappedTime < resultTime && swapped[last - 1] != swapped[last - 2] && deliversInOrder(swapped, courier)){
+                route = swapped;
+                resultTime = swappedTime;
             }
-
-
         }
+        if(resultTime < bestRouteTime){
+            bestRoute = route;
+            bestRouteTime = resultTime;
+        }
+    }
 
-        deliveriesBool.clear();
-        result.clear();
+    std::vector<CourierSubPath> finalResult;
+    for(int leg = 0; leg + 1 < bestRoute.size(); leg++){
+        CourierSubPath subPath;
+        subPath.start_intersection = courier.intersections[bestRoute[leg]];
+        subPath.end_intersection = courier.intersections[bestRoute[leg + 1]];
+        subPath.subpath = matrix.path(bestRoute[leg], bestRoute[leg + 1]);
+        finalResult.push_back(subPath);
     }
-    
-    closeM4();
-   
     return finalResult;
 }
-void loadM4(const float turn_penalty, const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots){
-
+void loadM4(RouteMatrix& matrix, const float turn_penalty, const std::vector<DeliveryInf>& deliveries, const std::vector<IntersectionIdx>& depots, CourierMatrix& courier){
+
+    //stop ids in order of first appearance: pick-ups, drop-offs, then depots
+    std::unordered_map <IntersectionIdx, int> stopOf;
+    auto addStop = [&](IntersectionIdx intersection, StopRole role){
+        auto inserted = stopOf.emplace(intersection, courier.numStops());
+        if(inserted.second){
+            courier.intersections.push_back(intersection);
+            courier.roles.push_back(0);
+        }
+        int stop = inserted.first->second;
+        courier.roles[stop] |= role;
+        return stop;
+    };
     for(int pickUp = 0; pickUp < deliveries.size(); pickUp++){
-        deliveryIntersections.push_back(deliveries[pickUp].pickUp);
+        courier.pickUpStops.push_back(addStop(deliveries[pickUp].pickUp, PickUpStop));
     }
     for(int dropOff = 0; dropOff < deliveries.size(); dropOff++){
-        deliveryIntersections.push_back(deliveries[dropOff].dropOff);
+        courier.dropOffStops.push_back(addStop(deliveries[dropOff].dropOff, DropOffStop));
     }
     for(int depot = 0; depot < depots.size(); depot++){
-        deliveryIntersections.push_back(depots[depot]);
+        courier.depotStops.push_back(addStop(depots[depot], DepotStop));
     }
 
-    
-    CourierPath currentElement;
-    CourierSubPath currentSubPath;
-
-    //drop offs as sources
-    for(int dropOff = 0; dropOff < deliveries.size(); dropOff++){
-         //Setting all nodes best times to a large number
-        for(int nodeIntersection = 0; nodeIntersection < getNumIntersections(); nodeIntersection++){
-            nodes[nodeIntersection].bestTime = BIGNUMBER;
-        }
-        multidestDijkstra(deliveries[dropOff].dropOff, turn_penalty);
-        for(int destination = 0; destination < deliveryIntersections.size(); destination++){
-            if(deliveryIntersections[destination] != deliveries[dropOff].dropOff){
-                currentSubPath.start_intersection =  deliveries[dropOff].dropOff;
-                currentSubPath.end_intersection = deliveryIntersections[destination];
-                currentSubPath.subpath = traceBack(deliveryIntersections[destination]);
-                currentElement.courierSubPath = currentSubPath;
-                currentElement.subPathTime = nodes[deliveryIntersections[destination]].bestTime;
-                if(destination < deliveries.size()){
-                    currentElement.destType = "pickUp";
-                } else if (destination < deliveries.size()*2){
-                    currentElement.destType = "dropOff";
-                } else {
-                    currentElement.destType = "depot";
-                }
-                pathsMatrix[deliveries[dropOff].dropOff].push_back(currentElement);
-            }
-            
-        }
-    }
-    //pick ups as sources
-    for(int pickUp = 0; pickUp < deliveries.size(); pickUp++){
-         //Setting all nodes best times to a large number
-        for(int nodeIntersection = 0; nodeIntersection < getNumIntersections(); nodeIntersection++){
-            nodes[nodeIntersection].bestTime = BIGNUMBER;
-        }
-        multidestDijkstra(deliveries[pickUp].pickUp, turn_penalty);
-        for(int destination = 0; destination < (deliveryIntersections.size() - depots.size()); destination++){
-            if(deliveryIntersections[destination] != deliveries[pickUp].pickUp){
-                currentSubPath.start_intersection =  deliveries[pickUp].pickUp;
-                currentSubPath.end_intersection = deliveryIntersections[destination];
-                currentSubPath.subpath = traceBack(deliveryIntersections[destination]);//cannot be threaded
-                currentElement.courierSubPath = currentSubPath;
-                currentElement.subPathTime = nodes[deliveryIntersections[destination]].bestTime; //cannot be threaded
-                if(destination < deliveries.size()){
-                    currentElement.destType = "pickUp";
-                } else {
-                    currentElement.destType = "dropOff";
-                }
-                pathsMatrix[deliveries[pickUp].pickUp].push_back(currentElement);
-            }
-        }
-    }
-    //depots as sources
-    for(int depot = 0; depot < depots.size(); depot++){
-        //Setting all nodes best times to a large number
-        for(int nodeIntersection = 0; nodeIntersection < getNumIntersections(); nodeIntersection++){
-            nodes[nodeIntersection].bestTime = BIGNUMBER;
-        }
-        multidestDijkstra(depots[depot], turn_penalty);
-        for(int destination = 0; destination < deliveries.size(); destination++){
-            if(deliveryIntersections[destination] != depots[depot]){
-                currentSubPath.start_intersection =  depots[depot];
-                currentSubPath.end_intersection = deliveryIntersections[destination];
-                currentSubPath.subpath = traceBack(deliveryIntersections[destination]);
-                currentElement.courierSubPath = currentSubPath;
-                currentElement.subPathTime = nodes[deliveryIntersections[destination]].bestTime;
-                currentElement.destType = "pickUp";
-                pathsMatrix[depots[depot]].push_back(currentElement);
-            }
+    //one many-to-many search over every stop, run on every core; rows and columns are stop ids
+    matrix.compute(courier.intersections, courier.intersections, turn_penalty);
+    const int numStops = courier.numStops();
+    courier.times.resize(static_cast<size_t>(numStops) * numStops);
+    for(int from = 0; from < numStops; from++){
+        for(int to = 0; to < numStops; to++){
+            courier.times[static_cast<size_t>(from) * numStops + to] = matrix.reachable(from, to) ? matrix.travelTime(from, to) : std::numeric_limits<float>::infinity();
         }
     }
 }
-void closeM4(){
-    pathsMatrix.clear();
-    deliveryIntersections.clear();
-}
-///////----------------------------------------------------------------------------------last resort
-void multidestDijkstra(IntersectionIdx srcID, float turn_penalty){
-    //priority queue/ min heap
-    std::priority_queue<WaveElem, std::vector<WaveElem>, timeWaveElemComparator> waveFrontMinHeap; 
-    //Initializing source node
-    waveFrontMinHeap.push(WaveElem(srcID, SOURCE_EDGE, 0,0));
-
-    //While heap is empty
-    while(waveFrontMinHeap.size() != 0){
-        //take top of heap and pop it
-        WaveElem wave = waveFrontMinHeap.top();
-        waveFrontMinHeap.pop();
-        
-        int currNodeID = wave.nodeID;
-        //if the node im on has a faster time than its best time 
-        if(wave.travelTime < nodes[currNodeID].bestTime){
-            nodes[currNodeID].reachingEdge = wave.edgeID;
-            nodes[currNodeID].bestTime = wave.travelTime;
-            
-            //vector of all segments coming out of the current node
-            std::vector<StreetSegmentIdx> outEdge = findStreetSegmentsOfIntersection(currNodeID);
-            //for loop looping through all of segments
-            for(int edge = 0; edge < outEdge.size(); edge++){
-                StreetSegmentInfo street_segment = street_segment_info[outEdge[edge]];
-                StreetSegmentInfo currNodeReachingEdge;
-                if(nodes[currNodeID].reachingEdge != SOURCE_EDGE){
-                    currNodeReachingEdge = street_segment_info[nodes[currNodeID].reachingEdge];
-                }
-                int toNodeID = 0;
-                if(street_segment.oneWay != true){
-                        if(currNodeID== street_segment.to){
-                            toNodeID = street_segment.from;
-                        } else {
-                            toNodeID = street_segment.to;
-                        }
-                        //calculating traveltime node and heuristic node
-                        double travelTimeNode = nodes[currNodeID].bestTime + findStreetSegmentTravelTime(outEdge[edge]);
-                        
-                        if(nodes[currNodeID].reachingEdge != SOURCE_EDGE && street_segment.streetID != currNodeReachingEdge.streetID){
-                            waveFrontMinHeap.push(WaveElem(toNodeID, outEdge[edge], travelTimeNode + turn_penalty, travelTimeNode + turn_penalty));
-                        } else{
-                            waveFrontMinHeap.push(WaveElem(toNodeID, outEdge[edge], travelTimeNode, travelTimeNode));
-                        }
-                } else {
-                    if(street_segment.from == currNodeID){
-                        //calculating traveltime node and heuristic node
-                        double travelTimeNode = nodes[currNodeID].bestTime + findStreetSegmentTravelTime(outEdge[edge]);
-                        if(nodes[currNodeID].reachingEdge != SOURCE_EDGE && street_segment.streetID != currNodeReachingEdge.streetID){
-                            waveFrontMinHeap.push(WaveElem(street_segment.to, outEdge[edge], travelTimeNode + turn_penalty, travelTimeNode + turn_penalty));
-                        }else {
-                            waveFrontMinHeap.push(WaveElem(street_segment.to, outEdge[edge], travelTimeNode, travelTimeNode));
-                        }
-                    }
-                }
-            }
-            
-        }
-
+double routeTime(const std::vector<int>& route, const CourierMatrix& courier){
+    double time = 0;
+    for(int leg = 0; leg + 1 < route.size(); leg++){
+        time += courier.timesFrom(route[leg])[route[leg + 1]];
     }
+    return time;
 }
-std::vector <StreetSegmentIdx> traceBack (int destID) {
-
-    std::list<StreetSegmentIdx> path;
-
-    int currNodeID = destID;
-
-    int prevEdge = nodes[currNodeID].reachingEdge;
-
-    //this while loops goes into nodes vector at destID and back tracks all previous edges until the previous edge of the source then returns a vector
-    while(prevEdge != SOURCE_EDGE){
-        
-        path.push_front(prevEdge);
-        StreetSegmentInfo street_segment = getStreetSegmentInfo(prevEdge);
-        if(currNodeID == street_segment.to){
-            currNodeID = street_segment.from;
-        }else{
-            currNodeID = street_segment.to;
+//True if every parcel is picked up no later than the last visit to its drop-off
+bool deliversInOrder(const std::vector<int>& route, const CourierMatrix& courier){
+    std::vector<int> firstVisit(courier.numStops(), route.size());
+    std::vector<int> lastVisit(courier.numStops(), -1);
+    for(int position = 0; position < route.size(); position++){
+        firstVisit[route[position]] = std::min(firstVisit[route[position]], position);
+        lastVisit[route[position]] = position;
+    }
+    for(int delivery = 0; delivery < courier.pickUpStops.size(); delivery++){
+        if(firstVisit[courier.pickUpStops[delivery]] > lastVisit[courier.dropOffStops[delivery]]){
+            return false;
         }
-        prevEdge = nodes[currNodeID].reachingEdge;
     }
-    std::vector <StreetSegmentIdx> outputVector(path.begin(), path.end());
-
-    return outputVector;
-}
\ No newline at end of file
+    return true;
+}
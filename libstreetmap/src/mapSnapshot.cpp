@@ -0,0 +1,503 @@
+#include "mapSnapshot.h"
+#include "m1.h"
+#include "StreetsDatabaseAPI.h"
+#include "OSMDatabaseAPI.h"
+#include "samiristhegoat.h"
+#include "streetGraph.h"
+#include "edgeBasedGraph.h"
+#include "landmarks.h"
+#include "heuristicGeometry.h"
+#include "streetIndex.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//Bump kSnapshotVersion whenever the layout of any serialized container, or how it is derived, changes
+constexpr char kSnapshotMagic[8] = {'G', 'I', 'S', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kSnapshotVersion = 14;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t streetsFileSize;
+    int64_t streetsFileMtime;
+    uint64_t osmFileSize;
+    int64_t osmFileMtime;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+//64-bit FNV-1a over the payload, used to reject truncated or corrupt snapshots
+uint64_t snapshotChecksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t byte = 0; byte < size; byte++) {
+        hash ^= static_cast<unsigned char>(data[byte]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool sourceFileStamp(const std::string& filename, uint64_t& size, int64_t& mtime) {
+    struct stat fileStat;
+    if (stat(filename.c_str(), &fileStat) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(fileStat.st_size);
+    mtime = static_cast<int64_t>(fileStat.st_mtime);
+    return true;
+}
+
+class SnapshotWriter {
+public:
+    template <typename T>
+    void pod(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot pod must be trivially copyable");
+        append(&value, sizeof(T));
+    }
+    void str(const std::string& value) {
+        pod<uint32_t>(value.size());
+        append(value.data(), value.size());
+    }
+    template <typename T, typename Allocator>
+    void podVector(const std::vector<T, Allocator>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot pod must be trivially copyable");
+        pod<uint32_t>(values.size());
+        append(values.data(), values.size() * sizeof(T));
+    }
+    void latLon(const LatLon& position) {
+        pod<double>(position.latitude());
+        pod<double>(position.longitude());
+    }
+    std::vector<char> buffer;
+
+private:
+    void append(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+};
+
+//Reads back what SnapshotWriter wrote. Every read is bounds checked; the first failure
+//latches ok = false and all later reads return default values.
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    T pod() {
+        T value{};
+        if (!ok || m_size - m_pos < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_data + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+    std::string str() {
+        uint32_t size = count(1);
+        if (!ok) {
+            return std::string();
+        }
+        std::string value(m_data + m_pos, size);
+        m_pos += size;
+        return value;
+    }
+    //element count, rejected if the remaining bytes cannot possibly hold that many elements
+    uint32_t count(size_t minBytesPerElement) {
+        uint32_t size = pod<uint32_t>();
+        if (ok && static_cast<uint64_t>(size) * minBytesPerElement > m_size - m_pos) {
+            ok = false;
+        }
+        return ok ? size : 0;
+    }
+    template <typename T, typename Allocator>
+    void podVector(std::vector<T, Allocator>& values) {
+        uint32_t size = count(sizeof(T));
+        values.resize(size);
+        if (ok && size != 0) {
+            std::memcpy(values.data(), m_data + m_pos, size * sizeof(T));
+            m_pos += size * sizeof(T);
+        }
+    }
+    LatLon latLon() {
+        double lat = pod<double>();
+        double lon = pod<double>();
+        return LatLon(lat, lon);
+    }
+    bool atEnd() const { return m_pos == m_size; }
+    bool ok = true;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+};
+
+void writeTagStore(SnapshotWriter& out, OSMTagStore& store) {
+    //the columns only hold the indexed keys, so a snapshot is tied to the tag index configuration
+    out.pod<uint32_t>(store.indexedKeys().size());
+    for (const std::string& key : store.indexedKeys()) {
+        out.str(key);
+    }
+    store.visitColumns([&out](const auto& column) { out.podVector(column); });
+}
+
+void readTagStore(SnapshotReader& in, OSMTagStore& store) {
+    uint32_t numIndexedKeys = in.count(sizeof(uint32_t));
+    std::vector<std::string> indexedKeys(numIndexedKeys);
+    for (std::string& key : indexedKeys) {
+        key = in.str();
+    }
+    if (indexedKeys != store.indexedKeys()) {
+        in.ok = false;
+        return;
+    }
+    store.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (in.ok && !store.columnsConsistent()) {
+        in.ok = false;
+    }
+    if (in.ok) {
+        store.finish();
+    }
+}
+
+void writeSnapshotPayload(SnapshotWriter& out) {
+    out.pod<double>(max_lat);
+    out.pod<double>(min_lat);
+    out.pod<double>(max_lon);
+    out.pod<double>(min_lon);
+    out.pod<double>(avg_lat);
+    out.pod<float>(max_speed_limit);
+
+    out.pod<uint32_t>(street_segment_info.size());
+    for (const StreetSegmentInfo& segment : street_segment_info) {
+        out.pod<uint64_t>(static_cast<uint64_t>(segment.wayOSMID));
+        out.pod<int32_t>(segment.from);
+        out.pod<int32_t>(segment.to);
+        out.pod<uint8_t>(segment.oneWay);
+        out.pod<int32_t>(segment.numCurvePoints);
+        out.pod<float>(segment.speedLimit);
+        out.pod<int32_t>(segment.streetID);
+    }
+    out.podVector(street_segment_length);
+
+    streetGraph.visitColumns([&out](const auto& column) { out.podVector(column); });
+    edgeBasedGraph.visitColumns([&out](const auto& column) { out.podVector(column); });
+    landmarkTable.visitColumns([&out](const auto& column) { out.podVector(column); });
+    heuristicGeometry.visitColumns([&out](const auto& column) { out.podVector(column); });
+    out.pod<uint32_t>(street_street_segments.size());
+    for (const auto& segments : street_street_segments) {
+        out.podVector(segments);
+    }
+    streetIntersectionIndex.visitColumns([&out](const auto& column) { out.podVector(column); });
+    out.pod<uint32_t>(street_lengths.size());
+    for (const auto& lengths : street_lengths) {
+        out.podVector(lengths);
+    }
+
+    streetNameIndex.visitColumns([&out](const auto& column) { out.podVector(column); });
+
+    out.pod<uint32_t>(intersections_xyposname.size());
+    for (const Intersection_data& intersection : intersections_xyposname) {
+        out.pod(intersection.xy_loc);
+        out.latLon(intersection.position);
+        out.str(intersection.name);
+    }
+    intersectionSpatialIndex.visitColumns([&out](const auto& column) { out.podVector(column); });
+
+    out.pod<uint32_t>(streetSegmentIdx_point2dxyCurvepoints.size());
+    for (const auto& curvePoints : streetSegmentIdx_point2dxyCurvepoints) {
+        out.podVector(curvePoints);
+    }
+
+    out.pod<uint32_t>(Features.size());
+    for (const featureStruct& feature : Features) {
+        out.podVector(feature.featurePoints);
+        out.pod<int32_t>(feature.numFeaturePoints);
+        out.pod<double>(feature.area);
+        out.str(feature.type);
+        out.pod<double>(feature.max_x);
+        out.pod<double>(feature.max_y);
+        out.pod<double>(feature.min_x);
+        out.pod<double>(feature.min_y);
+    }
+
+    out.pod<uint32_t>(poi_information.size());
+    for (const POI_data& poi : poi_information) {
+        out.pod(poi.xy_loc);
+        out.latLon(poi.position);
+        out.str(poi.name);
+        out.str(poi.type);
+    }
+    poiSpatialIndex.visitColumns([&out](const auto& column) { out.podVector(column); });
+
+    out.podVector(cityIndexes);
+    writeTagStore(out, OSMNodesandTags);
+    writeTagStore(out, OSMWaysandTags);
+}
+
+bool readSnapshotPayload(SnapshotReader& in) {
+    max_lat = in.pod<double>();
+    min_lat = in.pod<double>();
+    max_lon = in.pod<double>();
+    min_lon = in.pod<double>();
+    avg_lat = in.pod<double>();
+    max_speed_limit = in.pod<float>();
+
+    //the per-element counts must agree with the database that was just loaded
+    uint32_t numSegments = in.count(1);
+    if (numSegments != static_cast<uint32_t>(getNumStreetSegments())) {
+        return false;
+    }
+    street_segment_info.resize(numSegments);
+    for (StreetSegmentInfo& segment : street_segment_info) {
+        segment.wayOSMID = OSMID(in.pod<uint64_t>());
+        segment.from = in.pod<int32_t>();
+        segment.to = in.pod<int32_t>();
+        segment.oneWay = in.pod<uint8_t>() != 0;
+        segment.numCurvePoints = in.pod<int32_t>();
+        segment.speedLimit = in.pod<float>();
+        segment.streetID = in.pod<int32_t>();
+    }
+    in.podVector(street_segment_length);
+
+    streetGraph.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !streetGraph.columnsConsistent()) {
+        return false;
+    }
+    edgeBasedGraph.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !edgeBasedGraph.columnsConsistent()) {
+        return false;
+    }
+    landmarkTable.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !landmarkTable.columnsConsistent()) {
+        return false;
+    }
+    heuristicGeometry.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !heuristicGeometry.columnsConsistent()) {
+        return false;
+    }
+    heuristicGeometry.finish();
+    street_street_segments.resize(in.count(sizeof(uint32_t)));
+    for (auto& segments : street_street_segments) {
+        in.podVector(segments);
+    }
+    streetIntersectionIndex.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !streetIntersectionIndex.columnsConsistent()) {
+        return false;
+    }
+    street_lengths.resize(in.count(sizeof(uint32_t)));
+    for (auto& lengths : street_lengths) {
+        in.podVector(lengths);
+    }
+    if (street_street_segments.size() != static_cast<size_t>(getNumStreets())) {
+        return false;
+    }
+
+    streetNameIndex.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !streetNameIndex.columnsConsistent()) {
+        return false;
+    }
+
+    intersections_xyposname.resize(in.count(1));
+    for (Intersection_data& intersection : intersections_xyposname) {
+        intersection.xy_loc = in.pod<ezgl::point2d>();
+        intersection.position = in.latLon();
+        intersection.name = in.str();
+    }
+    intersectionSpatialIndex.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || intersectionSpatialIndex.size() != static_cast<size_t>(getNumIntersections()) ||
+        !intersectionSpatialIndex.columnsConsistent(getNumIntersections())) {
+        return false;
+    }
+
+    streetSegmentIdx_point2dxyCurvepoints.resize(in.count(sizeof(uint32_t)));
+    for (auto& curvePoints : streetSegmentIdx_point2dxyCurvepoints) {
+        in.podVector(curvePoints);
+    }
+
+    Features.resize(in.count(1));
+    for (featureStruct& feature : Features) {
+        in.podVector(feature.featurePoints);
+        feature.numFeaturePoints = in.pod<int32_t>();
+        feature.area = in.pod<double>();
+        feature.type = in.str();
+        feature.max_x = in.pod<double>();
+        feature.max_y = in.pod<double>();
+        feature.min_x = in.pod<double>();
+        feature.min_y = in.pod<double>();
+    }
+
+    poi_information.resize(in.count(1));
+    for (POI_data& poi : poi_information) {
+        poi.xy_loc = in.pod<ezgl::point2d>();
+        poi.position = in.latLon();
+        poi.name = in.str();
+        poi.type = in.str();
+    }
+    poiSpatialIndex.visitColumns([&in](auto& column) { in.podVector(column); });
+    if (!in.ok || !poiSpatialIndex.columnsConsistent(getNumPointsOfInterest())) {
+        return false;
+    }
+    poiSpatialIndex.finish();
+
+    in.podVector(cityIndexes);
+    readTagStore(in, OSMNodesandTags);
+    readTagStore(in, OSMWaysandTags);
+
+    return in.ok && in.atEnd();
+}
+
+void clearSnapshotContainers() {
+    street_segment_info.clear();
+    street_segment_length.clear();
+    streetGraph.clear();
+    edgeBasedGraph.clear();
+    landmarkTable.clear();
+    heuristicGeometry.clear();
+    street_street_segments.clear();
+    streetIntersectionIndex.clear();
+    street_lengths.clear();
+    streetNameIndex.clear();
+    intersections_xyposname.clear();
+    intersectionSpatialIndex.clear();
+    poiSpatialIndex.clear();
+    streetSegmentIdx_point2dxyCurvepoints.clear();
+    Features.clear();
+    poi_information.clear();
+    cityIndexes.clear();
+    OSMNodesandTags.clear();
+    OSMWaysandTags.clear();
+}
+
+//write(2) until everything is out, retrying short writes and interrupted calls
+bool writeAll(int fileDescriptor, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fileDescriptor, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+} //namespace
+
+std::string snapshotFileName(const std::string& map_streets_database_filename) {
+    std::string snapshotName = map_streets_database_filename;
+    std::string::size_type extension = snapshotName.rfind(".streets.bin");
+    if (extension != std::string::npos) {
+        snapshotName.erase(extension);
+    }
+    return snapshotName + ".snapshot.bin";
+}
+
+bool loadMapSnapshot(const std::string& map_streets_database_filename, const std::string& osm_database_filename) {
+    SnapshotHeader expected;
+    if (!sourceFileStamp(map_streets_database_filename, expected.streetsFileSize, expected.streetsFileMtime) ||
+        !sourceFileStamp(osm_database_filename, expected.osmFileSize, expected.osmFileMtime)) {
+        return false;
+    }
+
+    int fileDescriptor = open(snapshotFileName(map_streets_database_filename).c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    struct stat snapshotStat;
+    if (fstat(fileDescriptor, &snapshotStat) != 0 || static_cast<size_t>(snapshotStat.st_size) < sizeof(SnapshotHeader)) {
+        close(fileDescriptor);
+        return false;
+    }
+    size_t mappedSize = snapshotStat.st_size;
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+
+    const char* bytes = static_cast<const char*>(mapped);
+    SnapshotHeader header;
+    std::memcpy(&header, bytes, sizeof(SnapshotHeader));
+    const char* payload = bytes + sizeof(SnapshotHeader);
+
+    //stale (source map changed), foreign version, truncated or corrupt snapshots are all rebuilt
+    bool valid = std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0 &&
+                 header.version == kSnapshotVersion &&
+                 header.headerSize == sizeof(SnapshotHeader) &&
+                 header.streetsFileSize == expected.streetsFileSize &&
+                 header.streetsFileMtime == expected.streetsFileMtime &&
+                 header.osmFileSize == expected.osmFileSize &&
+                 header.osmFileMtime == expected.osmFileMtime &&
+                 header.payloadSize == mappedSize - sizeof(SnapshotHeader) &&
+                 header.checksum == snapshotChecksum(payload, header.payloadSize);
+
+    //the containers own their memory, so every column is copied out before the unmap
+    if (valid) {
+        SnapshotReader in(payload, header.payloadSize);
+        valid = readSnapshotPayload(in);
+    }
+    munmap(mapped, mappedSize);
+
+    if (!valid) {
+        clearSnapshotContainers();
+    }
+    return valid;
+}
+
+bool saveMapSnapshot(const std::string& map_streets_database_filename, const std::string& osm_database_filename) {
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(SnapshotHeader));
+    if (!sourceFileStamp(map_streets_database_filename, header.streetsFileSize, header.streetsFileMtime) ||
+        !sourceFileStamp(osm_database_filename, header.osmFileSize, header.osmFileMtime)) {
+        return false;
+    }
+
+    SnapshotWriter out;
+    writeSnapshotPayload(out);
+
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.version = kSnapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.payloadSize = out.buffer.size();
+    header.checksum = snapshotChecksum(out.buffer.data(), out.buffer.size());
+
+    //write to a uniquely named temporary file in the same directory and rename it over the
+    //snapshot, so concurrent loaders never map a half-written file and concurrent writers
+    //never share a temporary
+    std::string snapshotName = snapshotFileName(map_streets_database_filename);
+    std::string temporaryName = snapshotName + ".XXXXXX";
+    int fileDescriptor = mkstemp(&temporaryName[0]);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    //mkstemp creates the file owner-only; a snapshot is as readable as the map it came from
+    bool written = fchmod(fileDescriptor, 0644) == 0 &&
+        writeAll(fileDescriptor, reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader)) &&
+        writeAll(fileDescriptor, out.buffer.data(), out.buffer.size());
+    written = close(fileDescriptor) == 0 && written;
+    if (!written) {
+        unlink(temporaryName.c_str());
+        return false;
+    }
+    if (std::rename(temporaryName.c_str(), snapshotName.c_str()) != 0) {
+        unlink(temporaryName.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef MAPSNAPSHOT_H
+#define MAPSNAPSHOT_H
+
+#include <string>
+
+//Binary snapshot of everything loadMap derives from the streets and OSM databases.
+//The snapshot is written next to the .streets.bin file and reloaded on later runs so
+//the derived containers can be filled without re-walking the databases.
+//Loading deserializes from a mapping: the file is memory-mapped, checksummed in full and
+//then copied column by column into the ordinary std::vector containers, after which the
+//mapping is dropped. Nothing is served from the mapped pages, so a load still touches and
+//copies every byte; what it saves is the database walks and the derivation work.
+
+//Returns the snapshot file name that belongs to the given .streets.bin file
+std::string snapshotFileName(const std::string& map_streets_database_filename);
+
+//Fills the derived map containers from the snapshot. Returns false (and leaves the
+//containers cleared) if the snapshot is missing, stale, corrupt or from another version.
+bool loadMapSnapshot(const std::string& map_streets_database_filename, const std::string& osm_database_filename);
+
+//Writes the currently loaded map containers to the snapshot file. Returns false if the
+//file could not be written (e.g. read-only map directory); the map stays usable either way.
+bool saveMapSnapshot(const std::string& map_streets_database_filename, const std::string& osm_database_filename);
+
+#endif //MAPSNAPSHOT_H
@@ -0,0 +1,242 @@
+#include "osmTagStore.h"
+#include <algorithm>
+
+uint32_t StringDictionary::intern(std::string_view value) {
+    auto inserted = m_building.emplace(std::string(value), size());
+    if (inserted.second) {
+        chars.insert(chars.end(), value.begin(), value.end());
+        offsets.push_back(chars.size());
+    }
+    return inserted.first->second;
+}
+
+void StringDictionary::freeze(bool keepLookup) {
+    m_building.clear();
+    m_building.rehash(0);
+    m_lookup.clear();
+    if (keepLookup) {
+        //the buffer no longer grows, so views into it stay valid as hash keys
+        m_lookup.reserve(size());
+        for (uint32_t id = 0; id < size(); id++) {
+            m_lookup.emplace((*this)[id], id);
+        }
+    }
+}
+
+bool StringDictionary::find(std::string_view value, uint32_t& id) const {
+    auto found = m_lookup.find(value);
+    if (found == m_lookup.end()) {
+        return false;
+    }
+    id = found->second;
+    return true;
+}
+
+bool StringDictionary::consistent() const {
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != chars.size()) {
+        return false;
+    }
+    return std::is_sorted(offsets.begin(), offsets.end());
+}
+
+size_t StringDictionary::memoryBytes() const {
+    size_t hashNodes = 4 * sizeof(void*);
+    return chars.capacity() + offsets.capacity() * sizeof(uint32_t) +
+           m_lookup.bucket_count() * sizeof(void*) + m_lookup.size() * hashNodes;
+}
+
+void StringDictionary::clear() {
+    chars.clear();
+    chars.shrink_to_fit();
+    offsets.assign(1, 0);
+    offsets.shrink_to_fit();
+    m_building.clear();
+    m_lookup.clear();
+}
+
+void OSMTagStore::configure(OSMEntityKind kind, const std::vector<std::string>& indexedKeys) {
+    m_kind = kind;
+    m_indexedKeys = indexedKeys;
+}
+
+bool OSMTagStore::indexesKey(std::string_view key) const {
+    if (m_indexedKeys.empty()) {
+        return true;
+    }
+    //only a handful of keys, a linear scan beats hashing
+    for (const std::string& indexedKey : m_indexedKeys) {
+        if (indexedKey == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OSMTagStore::beginEntity(OSMID id, int databaseIndex) {
+    IdEntry entry;
+    entry.id = static_cast<uint64_t>(id);
+    entry.index = numEntities();
+    entry.databaseIndex = databaseIndex;
+    m_ids.push_back(entry);
+    m_tagBegin.push_back(m_tagKeys.size());
+}
+
+void OSMTagStore::addTag(std::string_view key, std::string_view value) {
+    m_tagKeys.push_back(m_keys.intern(key));
+    m_tagValues.push_back(m_values.intern(value));
+    m_tagBegin.back() = m_tagKeys.size();
+}
+
+void OSMTagStore::append(const OSMTagStore& chunk) {
+    //chunks have few distinct keys, so translate every chunk id once instead of per tag
+    std::vector<uint32_t> keyIds(chunk.m_keys.size());
+    for (uint32_t key = 0; key < chunk.m_keys.size(); key++) {
+        keyIds[key] = m_keys.intern(chunk.m_keys[key]);
+    }
+    std::vector<uint32_t> valueIds(chunk.m_values.size());
+    for (uint32_t value = 0; value < chunk.m_values.size(); value++) {
+        valueIds[value] = m_values.intern(chunk.m_values[value]);
+    }
+
+    uint32_t firstIndex = numEntities();
+    uint32_t firstTag = numTags();
+    for (IdEntry entry : chunk.m_ids) {
+        entry.index += firstIndex;
+        m_ids.push_back(entry);
+    }
+    for (size_t entity = 1; entity < chunk.m_tagBegin.size(); entity++) {
+        m_tagBegin.push_back(firstTag + chunk.m_tagBegin[entity]);
+    }
+    for (size_t tag = 0; tag < chunk.numTags(); tag++) {
+        m_tagKeys.push_back(keyIds[chunk.m_tagKeys[tag]]);
+        m_tagValues.push_back(valueIds[chunk.m_tagValues[tag]]);
+    }
+}
+
+void OSMTagStore::finish() {
+    std::sort(m_ids.begin(), m_ids.end(), [](const IdEntry& a, const IdEntry& b) { return a.id < b.id; });
+    m_keys.freeze(true);
+    m_values.freeze(false);
+    m_tagBegin.shrink_to_fit();
+    m_tagKeys.shrink_to_fit();
+    m_tagValues.shrink_to_fit();
+    m_ids.shrink_to_fit();
+}
+
+bool OSMTagStore::columnsConsistent() const {
+    if (!m_keys.consistent() || !m_values.consistent() || m_tagBegin.empty() || m_tagBegin.front() != 0 ||
+        m_tagBegin.back() != m_tagKeys.size() || m_tagKeys.size() != m_tagValues.size() ||
+        m_ids.size() != numEntities() || !std::is_sorted(m_tagBegin.begin(), m_tagBegin.end())) {
+        return false;
+    }
+    for (size_t tag = 0; tag < numTags(); tag++) {
+        if (m_tagKeys[tag] >= m_keys.size() || m_tagValues[tag] >= m_values.size()) {
+            return false;
+        }
+    }
+    uint32_t databaseSize = m_kind == OSMEntityKind::Node ? getNumberOfNodes() : getNumberOfWays();
+    for (const IdEntry& entry : m_ids) {
+        if (entry.index >= numEntities() || entry.databaseIndex >= databaseSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const OSMTagStore::IdEntry* OSMTagStore::findEntity(OSMID id) const {
+    uint64_t rawId = static_cast<uint64_t>(id);
+    auto found = std::lower_bound(m_ids.begin(), m_ids.end(), rawId, [](const IdEntry& entry, uint64_t value) { return entry.id < value; });
+    if (found == m_ids.end() || found->id != rawId) {
+        return nullptr;
+    }
+    return &*found;
+}
+
+int OSMTagStore::indexOf(OSMID id) const {
+    const IdEntry* entity = findEntity(id);
+    return entity == nullptr ? -1 : entity->index;
+}
+
+std::string_view OSMTagStore::value(int index, uint32_t keyId) const {
+    for (uint32_t tag = m_tagBegin[index]; tag < m_tagBegin[index + 1]; tag++) {
+        if (m_tagKeys[tag] == keyId) {
+            return m_values[m_tagValues[tag]];
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view OSMTagStore::value(OSMID id, std::string_view key) const {
+    if (!indexesKey(key)) {
+        const IdEntry* entity = findEntity(id);
+        return entity == nullptr ? std::string_view() : resolveLazily(*entity, key);
+    }
+    uint32_t keyIndex;
+    if (!keyId(key, keyIndex)) {
+        return std::string_view();
+    }
+    int index = indexOf(id);
+    if (index < 0) {
+        return std::string_view();
+    }
+    return value(index, keyIndex);
+}
+
+std::string_view OSMTagStore::resolveLazily(const IdEntry& entity, std::string_view key) const {
+    std::lock_guard<std::mutex> lock(m_resolvedLock);
+    uint64_t memoKey = (static_cast<uint64_t>(entity.index) << 32) | m_lazyKeys.intern(key);
+    auto resolved = m_resolved.find(memoKey);
+    if (resolved != m_resolved.end()) {
+        return resolved->second;
+    }
+
+    //misses are memoized too (as an empty value) so each pair hits the database once
+    std::string& value = m_resolved[memoKey];
+    if (m_kind == OSMEntityKind::Node) {
+        const OSMNode* node = getNodeByIndex(entity.databaseIndex);
+        for (int tagNumber = 0; tagNumber < getTagCount(node); tagNumber++) {
+            std::pair<std::string, std::string> tag = getTagPair(node, tagNumber);
+            if (tag.first == key) {
+                value = std::move(tag.second);
+                break;
+            }
+        }
+    } else {
+        const OSMWay* way = getWayByIndex(entity.databaseIndex);
+        for (int tagNumber = 0; tagNumber < getTagCount(way); tagNumber++) {
+            std::pair<std::string, std::string> tag = getTagPair(way, tagNumber);
+            if (tag.first == key) {
+                value = std::move(tag.second);
+                break;
+            }
+        }
+    }
+    return value;
+}
+
+size_t OSMTagStore::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(m_resolvedLock);
+    size_t resolvedBytes = m_resolved.bucket_count() * sizeof(void*) + m_resolved.size() * (sizeof(std::pair<const uint64_t, std::string>) + 2 * sizeof(void*));
+    for (const auto& resolved : m_resolved) {
+        resolvedBytes += resolved.second.capacity() > 15 ? resolved.second.capacity() + 1 : 0;
+    }
+    return sizeof(OSMTagStore) + m_keys.memoryBytes() + m_values.memoryBytes() + m_lazyKeys.memoryBytes() + resolvedBytes +
+           (m_tagBegin.capacity() + m_tagKeys.capacity() + m_tagValues.capacity()) * sizeof(uint32_t) +
+           m_ids.capacity() * sizeof(IdEntry);
+}
+
+void OSMTagStore::clear() {
+    m_keys.clear();
+    m_values.clear();
+    m_tagBegin.assign(1, 0);
+    m_tagBegin.shrink_to_fit();
+    m_tagKeys.clear();
+    m_tagKeys.shrink_to_fit();
+    m_tagValues.clear();
+    m_tagValues.shrink_to_fit();
+    m_ids.clear();
+    m_ids.shrink_to_fit();
+    std::lock_guard<std::mutex> lock(m_resolvedLock);
+    m_lazyKeys.clear();
+    m_resolved.clear();
+}
@@ -0,0 +1,128 @@
+#ifndef OSMTAGSTORE_H
+#define OSMTAGSTORE_H
+
+#include "OSMDatabaseAPI.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//Set of distinct strings stored back to back in one buffer. String i is
+//chars[offsets[i], offsets[i + 1]), so a dictionary costs one allocation per
+//buffer instead of one per string, and ids are small integers.
+class StringDictionary {
+public:
+    StringDictionary() : offsets(1, 0) {}
+
+    //Returns the id of value, adding it if it is new. Only valid before freeze().
+    uint32_t intern(std::string_view value);
+    //Drops the build-time table; keepLookup keeps find() working on the final buffer
+    void freeze(bool keepLookup);
+    bool find(std::string_view value, uint32_t& id) const;
+
+    std::string_view operator[](uint32_t id) const {
+        return std::string_view(chars.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+    uint32_t size() const { return offsets.size() - 1; }
+    bool consistent() const;
+    size_t memoryBytes() const;
+    void clear();
+
+    std::vector<char> chars;
+    std::vector<uint32_t> offsets;
+
+private:
+    std::unordered_map<std::string, uint32_t> m_building;
+    std::unordered_map<std::string_view, uint32_t> m_lookup;
+};
+
+enum class OSMEntityKind {
+    Node,
+    Way
+};
+
+//Columnar store of the tags of every OSM node (or way). Keys and values are
+//interned, the tags of one entity are a contiguous run of (key id, value id)
+//and OSMIDs map to the dense entity index through a sorted table.
+//
+//In lazy mode only the configured keys are copied while loading. Any other key
+//is read from the OSM database the first time it is asked for on an entity and
+//memoized, so the OSM database must stay loaded while the store is in use.
+class OSMTagStore {
+public:
+    //indexedKeys empty: copy every tag. Otherwise only these keys are indexed eagerly.
+    //Kept across clear(); call before building or reading the store.
+    void configure(OSMEntityKind kind, const std::vector<std::string>& indexedKeys);
+    bool indexesKey(std::string_view key) const;
+    const std::vector<std::string>& indexedKeys() const { return m_indexedKeys; }
+
+    //Building: entities are appended in order, each followed by its tags (only the
+    //indexed ones in lazy mode). Entities without tags can be left out, lookups treat
+    //them the same way. databaseIndex is the entity's index in the OSM database.
+    void beginEntity(OSMID id, int databaseIndex);
+    void addTag(std::string_view key, std::string_view value);
+    //Appends every entity of a store built on another thread (re-interning its strings)
+    void append(const OSMTagStore& chunk);
+    //Sorts the id table and drops the build-time tables; required before any lookup
+    void finish();
+
+    //Value of key on the entity, or an empty view if the entity or key is unknown.
+    //The view stays valid until the store is cleared. Safe to call from several threads.
+    std::string_view value(OSMID id, std::string_view key) const;
+    //Dense index of the entity, or -1 if it has no entry
+    int indexOf(OSMID id) const;
+    //Id of an interned key, so hot loops can skip the key hash
+    bool keyId(std::string_view key, uint32_t& id) const { return m_keys.find(key, id); }
+    std::string_view value(int index, uint32_t keyId) const;
+
+    //True if every offset and id in the columns is in range
+    bool columnsConsistent() const;
+
+    size_t numEntities() const { return m_tagBegin.size() - 1; }
+    size_t numTags() const { return m_tagKeys.size(); }
+    size_t memoryBytes() const;
+    void clear();
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot.
+    //Call columnsConsistent() and then finish() after the columns have been filled this way.
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_keys.chars);
+        visit(m_keys.offsets);
+        visit(m_values.chars);
+        visit(m_values.offsets);
+        visit(m_tagBegin);
+        visit(m_tagKeys);
+        visit(m_tagValues);
+        visit(m_ids);
+    }
+
+private:
+    struct IdEntry {
+        uint64_t id;
+        uint32_t index;
+        uint32_t databaseIndex;
+    };
+
+    const IdEntry* findEntity(OSMID id) const;
+    std::string_view resolveLazily(const IdEntry& entity, std::string_view key) const;
+
+    OSMEntityKind m_kind = OSMEntityKind::Node;
+    std::vector<std::string> m_indexedKeys;
+
+    StringDictionary m_keys;
+    StringDictionary m_values;
+    std::vector<uint32_t> m_tagBegin = std::vector<uint32_t>(1, 0);  //entity i owns tags [m_tagBegin[i], m_tagBegin[i + 1])
+    std::vector<uint32_t> m_tagKeys;
+    std::vector<uint32_t> m_tagValues;
+    std::vector<IdEntry> m_ids;                                      //sorted by id once finished
+
+    //lazy mode: values read from the database, keyed by entity index and key id
+    mutable std::mutex m_resolvedLock;
+    mutable StringDictionary m_lazyKeys;
+    mutable std::unordered_map<uint64_t, std::string> m_resolved;
+};
+
+#endif //OSMTAGSTORE_H
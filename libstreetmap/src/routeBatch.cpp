@@ -0,0 +1,43 @@
+#include "routeBatch.h"
+#include "m3.h"
+#include "samiristhegoat.h"
+#include "routingContext.h"
+#include "routeCache.h"
+#include "taskGraph.h"
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+std::vector<RouteAnswer> findPathsBatch(const std::vector<RouteQuery>& queries, unsigned numThreads) {
+    std::vector<RouteAnswer> answers(queries.size());
+    if (queries.empty()) {
+        return answers;
+    }
+    //queries cost up to milliseconds each, so chunks are far smaller than TaskGraph's default
+    const int chunksPerThread = 8;
+    numThreads = std::max(1u, numThreads);
+    int numQueries = static_cast<int>(queries.size());
+    int chunkSize = std::max(1, numQueries / static_cast<int>(numThreads * chunksPerThread));
+    RoutingEngine engine = routingEngine;
+
+    TaskGraph graph(numThreads);
+    graph.addParallelFor("route queries", 0, numQueries, chunkSize, [&](int begin, int end) {
+        std::unique_ptr<RoutingContext> context = acquirePooledRoutingContext();
+        for (int query = begin; query < end; query++) {
+            const RouteQuery& route = queries[query];
+            CachedRoute cached;
+            if (!routeCache.find(route.source, route.destination, route.turnPenalty, cached)) {
+                cached.path = context->findPath(route.source, route.destination, route.turnPenalty, engine);
+                cached.travelTime = computePathTravelTime(cached.path, route.turnPenalty);
+                routeCache.insert(route.source, route.destination, route.turnPenalty, cached);
+            }
+            RouteAnswer& answer = answers[query];
+            answer.found = !cached.path.empty() || route.source == route.destination;
+            answer.travelTime = cached.travelTime;
+            answer.path = std::move(cached.path);
+        }
+        releasePooledRoutingContext(std::move(context));
+    });
+    graph.run();
+    return answers;
+}
@@ -0,0 +1,25 @@
+#ifndef ROUTEBATCH_H
+#define ROUTEBATCH_H
+
+#include "StreetsDatabaseAPI.h"
+#include <thread>
+#include <vector>
+
+struct RouteQuery {
+    IntersectionIdx source;
+    IntersectionIdx destination;
+    double turnPenalty;
+};
+
+struct RouteAnswer {
+    std::vector<StreetSegmentIdx> path;
+    double travelTime = 0;
+    bool found = false;             //false if the destination cannot be reached
+};
+
+//Answers every query with the current routing engine, or from routeCache, spread over a
+//work-stealing TaskGraph. Workers draw their scratch from the pooled RoutingContexts kept between
+//batches, so a batch only pays for the searches. Answers are in input order.
+std::vector<RouteAnswer> findPathsBatch(const std::vector<RouteQuery>& queries, unsigned numThreads = std::thread::hardware_concurrency());
+
+#endif //ROUTEBATCH_H
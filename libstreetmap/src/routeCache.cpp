@@ -0,0 +1,105 @@
+#include "routeCache.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+size_t capacityFromEnvironment() {
+    const size_t defaultCapacity = 4096;
+    const char* entries = std::getenv("MAPPER_ROUTE_CACHE");
+    if (entries == nullptr) {
+        return defaultCapacity;
+    }
+    return std::strtoul(entries, nullptr, 10);
+}
+
+} //namespace
+
+RouteCache routeCache(capacityFromEnvironment());
+
+size_t RouteCache::KeyHash::operator()(const Key& key) const {
+    uint64_t penaltyBits;
+    std::memcpy(&penaltyBits, &key.turnPenalty, sizeof(penaltyBits));
+    uint64_t hash = (static_cast<uint64_t>(static_cast<uint32_t>(key.source)) << 32) | static_cast<uint32_t>(key.destination);
+    hash ^= penaltyBits + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    //spread the endpoint bits over the whole word (splitmix64 finalizer)
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(hash ^ (hash >> 31));
+}
+
+RouteCache::RouteCache(size_t capacity) : m_capacity(capacity) {
+}
+
+bool RouteCache::find(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, CachedRoute& route) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto entry = m_entries.find(Key{source, destination, turnPenalty});
+    if (entry == m_entries.end()) {
+        m_statistics.misses++;
+        return false;
+    }
+    m_statistics.hits++;
+    m_recency.splice(m_recency.begin(), m_recency, entry->second);
+    route = entry->second->route;
+    return true;
+}
+
+void RouteCache::insert(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, const CachedRoute& route) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_capacity == 0) {
+        return;
+    }
+    Key key{source, destination, turnPenalty};
+    auto entry = m_entries.find(key);
+    if (entry != m_entries.end()) {
+        entry->second->route = route;
+        m_recency.splice(m_recency.begin(), m_recency, entry->second);
+        return;
+    }
+    evictDownTo(m_capacity - 1);
+    m_recency.push_front(Entry{key, route});
+    m_entries.emplace(key, m_recency.begin());
+}
+
+void RouteCache::invalidate() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries.clear();
+    m_recency.clear();
+}
+
+void RouteCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_capacity = capacity;
+    evictDownTo(capacity);
+}
+
+size_t RouteCache::capacity() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_capacity;
+}
+
+RouteCache::Statistics RouteCache::statistics() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    Statistics statistics = m_statistics;
+    statistics.entries = m_entries.size();
+    return statistics;
+}
+
+size_t RouteCache::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    //list and hash nodes carry a couple of pointers next to the value
+    size_t bytes = sizeof(RouteCache) + m_entries.bucket_count() * sizeof(void*) +
+                   m_entries.size() * (sizeof(Entry) + sizeof(Key) + sizeof(std::list<Entry>::iterator) + 4 * sizeof(void*));
+    for (const Entry& entry : m_recency) {
+        bytes += entry.route.path.capacity() * sizeof(StreetSegmentIdx);
+    }
+    return bytes;
+}
+
+void RouteCache::evictDownTo(size_t entries) {
+    while (m_entries.size() > entries) {
+        m_entries.erase(m_recency.back().key);
+        m_recency.pop_back();
+        m_statistics.evictions++;
+    }
+}
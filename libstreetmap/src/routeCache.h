@@ -0,0 +1,74 @@
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct CachedRoute {
+    std::vector<StreetSegmentIdx> path;
+    double travelTime = 0;
+};
+
+//Bounded least-recently-used cache of answered route queries, keyed by source, destination
+//and turn penalty. Safe to use from several threads. Every cached path depends on the loaded
+//map and its travel times, so the cache must be invalidated whenever either changes; loadMap
+//and closeMap do it for map switches.
+class RouteCache {
+public:
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+    };
+
+    explicit RouteCache(size_t capacity);
+
+    //Copies the cached route out and marks it most recently used; false (a miss) if absent
+    bool find(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, CachedRoute& route);
+    //Adds or refreshes a route, evicting the least recently used one when full
+    void insert(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, const CachedRoute& route);
+    //Drops every route; the counters keep running
+    void invalidate();
+
+    //0 disables the cache
+    void setCapacity(size_t capacity);
+    size_t capacity() const;
+    Statistics statistics() const;
+    size_t memoryBytes() const;
+
+private:
+    struct Key {
+        IntersectionIdx source;
+        IntersectionIdx destination;
+        double turnPenalty;
+        bool operator==(const Key& other) const {
+            return source == other.source && destination == other.destination && turnPenalty == other.turnPenalty;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    struct Entry {
+        Key key;
+        CachedRoute route;
+    };
+
+    void evictDownTo(size_t entries);
+
+    mutable std::mutex m_lock;
+    size_t m_capacity;
+    std::list<Entry> m_recency;         //most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_entries;
+    Statistics m_statistics;
+};
+
+//Cache in front of findPathBetweenIntersections and findPathsBatch; MAPPER_ROUTE_CACHE=<entries>
+//sets its capacity (default 4096, 0 turns it off)
+extern RouteCache routeCache;
+
+#endif //ROUTECACHE_H
@@ -0,0 +1,214 @@
+#include "routeMatrix.h"
+#include "samiristhegoat.h"
+#include "routingContext.h"
+#include "taskGraph.h"
+#include "edgeBasedGraph.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+//Backward search entry waiting on an arc for the forward searches to pass by
+struct BucketEntry {
+    int32_t destination;
+    int32_t treeArc;
+    double time;
+};
+
+} //namespace
+
+void RouteMatrix::compute(const std::vector<IntersectionIdx>& sources, const std::vector<IntersectionIdx>& destinations, double turnPenalty,
+                          Method method, unsigned numThreads) {
+    clear();
+    m_sources = sources;
+    m_destinations = destinations;
+    m_times.assign(sources.size() * destinations.size(), kUnreachedTime);
+    if (method == Method::Automatic) {
+        bool buckets = contractionHierarchies.built(turnPenalty) != nullptr || routingEngine == RoutingEngine::ContractionHierarchies;
+        method = buckets ? Method::Buckets : Method::Sweep;
+    }
+    //searches cost up to milliseconds each, so chunks are far smaller than TaskGraph's default
+    const int chunksPerThread = 8;
+    numThreads = std::max(1u, numThreads);
+    int chunkSize = std::max(1, std::max(numSources(), numDestinations()) / static_cast<int>(numThreads * chunksPerThread));
+    TaskGraph graph(numThreads);
+    if (method == Method::Buckets) {
+        m_hierarchy = &contractionHierarchies.forTurnPenalty(turnPenalty);
+        computeBuckets(graph, chunkSize);
+    } else {
+        computeSweep(graph, chunkSize, turnPenalty);
+    }
+}
+
+//Every search owns a row of the results (or a backward tree), all sized before the workers
+//start, so they write without locks; only the settled counts are shared.
+void RouteMatrix::computeBuckets(TaskGraph& graph, int chunkSize) {
+    m_forwardTrees.resize(m_sources.size());
+    m_backwardTrees.resize(m_destinations.size());
+    m_meetings.assign(m_times.size(), Meeting());
+    std::atomic<size_t> settledArcs{0};
+
+    TaskGraph::TaskId backward = graph.addParallelFor("backward searches", 0, numDestinations(), chunkSize, [&](int begin, int end) {
+        std::unique_ptr<RoutingContext> context = acquirePooledRoutingContext();
+        ContractionHierarchy::Scratch& scratch = context->hierarchyScratch();
+        for (int destination = begin; destination < end; destination++) {
+            m_hierarchy->searchUpward(m_destinations[destination], false, scratch, m_backwardTrees[destination]);
+            settledArcs += scratch.settledArcs();
+        }
+        releasePooledRoutingContext(std::move(context));
+    });
+
+    //every arc a backward search settled gets a bucket entry, laid out per arc like the hierarchy's edges
+    int numArcs = m_hierarchy->numArcs();
+    std::vector<uint32_t> bucketBegin;
+    std::vector<BucketEntry> buckets;
+    TaskGraph::TaskId fillBuckets = graph.addTask("fill buckets", [&]() {
+        bucketBegin.assign(numArcs + 1, 0);
+        for (const SearchTree& tree : m_backwardTrees) {
+            for (const ContractionHierarchy::SearchTreeArc& settled : tree) {
+                bucketBegin[settled.arc + 1]++;
+            }
+        }
+        for (int arc = 0; arc < numArcs; arc++) {
+            bucketBegin[arc + 1] += bucketBegin[arc];
+        }
+        buckets.resize(bucketBegin[numArcs]);
+        std::vector<uint32_t> filled(bucketBegin.begin(), bucketBegin.end() - 1);
+        for (int destination = 0; destination < numDestinations(); destination++) {
+            const SearchTree& tree = m_backwardTrees[destination];
+            for (size_t entry = 0; entry < tree.size(); entry++) {
+                buckets[filled[tree[entry].arc]++] = BucketEntry{destination, static_cast<int32_t>(entry), tree[entry].time};
+            }
+        }
+    }, {backward});
+
+    //each forward search meets every destination whose bucket lies on an arc it settles
+    graph.addParallelFor("forward searches", 0, numSources(), chunkSize, [&](int begin, int end) {
+        std::unique_ptr<RoutingContext> context = acquirePooledRoutingContext();
+        ContractionHierarchy::Scratch& scratch = context->hierarchyScratch();
+        for (int source = begin; source < end; source++) {
+            SearchTree& tree = m_forwardTrees[source];
+            m_hierarchy->searchUpward(m_sources[source], true, scratch, tree);
+            settledArcs += scratch.settledArcs();
+            double* times = &m_times[cell(source, 0)];
+            Meeting* meetings = &m_meetings[cell(source, 0)];
+            for (size_t entry = 0; entry < tree.size(); entry++) {
+                for (uint32_t bucket = bucketBegin[tree[entry].arc]; bucket < bucketBegin[tree[entry].arc + 1]; bucket++) {
+                    const BucketEntry& waiting = buckets[bucket];
+                    double time = tree[entry].time + waiting.time;
+                    if (time < times[waiting.destination]) {
+                        times[waiting.destination] = time;
+                        meetings[waiting.destination] = Meeting{static_cast<int32_t>(entry), waiting.treeArc};
+                    }
+                }
+            }
+            //the searches would go around a loop instead, findPathBetweenIntersections returns no path
+            for (int destination = 0; destination < numDestinations(); destination++) {
+                if (m_sources[source] == m_destinations[destination]) {
+                    times[destination] = 0;
+                    meetings[destination] = Meeting();
+                }
+            }
+        }
+        releasePooledRoutingContext(std::move(context));
+    }, {fillBuckets});
+
+    graph.run();
+    m_settledArcs = settledArcs;
+}
+
+void RouteMatrix::computeSweep(TaskGraph& graph, int chunkSize, double turnPenalty) {
+    m_pathTrees.resize(m_sources.size());
+    m_meetings.assign(m_times.size(), Meeting());
+    std::atomic<size_t> settledArcs{0};
+    graph.addParallelFor("target searches", 0, numSources(), chunkSize, [&](int begin, int end) {
+        std::unique_ptr<RoutingContext> context = acquirePooledRoutingContext();
+        std::unordered_map<ArcIdx, int32_t> entryOf;
+        std::vector<ArcIdx> newArcs;
+        for (int source = begin; source < end; source++) {
+            context->searchTargets(m_sources[source], m_destinations, turnPenalty);
+            settledArcs += context->settledArcs();
+            PathTree& tree = m_pathTrees[source];
+            entryOf.clear();
+            for (int destination = 0; destination < numDestinations(); destination++) {
+                IntersectionIdx target = m_destinations[destination];
+                if (m_sources[source] == target) {
+                    m_times[cell(source, destination)] = 0;
+                    continue;
+                }
+                if (!context->reached(target)) {
+                    continue;
+                }
+                m_times[cell(source, destination)] = context->travelTime(target);
+                //walk back until the path joins one already in the tree, then add the new arcs source first
+                int32_t parent = -1;
+                newArcs.clear();
+                for (ArcIdx arc = context->reachingArc(target); arc != SOURCE_EDGE; arc = context->previousArc(arc)) {
+                    auto known = entryOf.find(arc);
+                    if (known != entryOf.end()) {
+                        parent = known->second;
+                        break;
+                    }
+                    newArcs.push_back(arc);
+                }
+                for (auto arc = newArcs.rbegin(); arc != newArcs.rend(); ++arc) {
+                    entryOf.emplace(*arc, static_cast<int32_t>(tree.size()));
+                    tree.push_back(PathArc{*arc, parent});
+                    parent = static_cast<int32_t>(tree.size()) - 1;
+                }
+                m_meetings[cell(source, destination)].forward = parent;
+            }
+        }
+        releasePooledRoutingContext(std::move(context));
+    });
+    graph.run();
+    m_settledArcs = settledArcs;
+}
+
+std::vector<StreetSegmentIdx> RouteMatrix::path(int source, int destination) const {
+    const Meeting& meeting = m_meetings[cell(source, destination)];
+    if (meeting.forward < 0) {
+        return {};
+    }
+    if (m_hierarchy == nullptr) {
+        const PathTree& tree = m_pathTrees[source];
+        std::vector<StreetSegmentIdx> path;
+        for (int32_t entry = meeting.forward; entry >= 0; entry = tree[entry].parent) {
+            path.push_back(EdgeBasedGraph::segmentOf(tree[entry].arc));
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+    return m_hierarchy->unpackPath(m_forwardTrees[source], meeting.forward, m_backwardTrees[destination], meeting.backward);
+}
+
+size_t RouteMatrix::memoryBytes() const {
+    size_t bytes = sizeof(RouteMatrix) + (m_sources.capacity() + m_destinations.capacity()) * sizeof(IntersectionIdx) +
+                   m_times.capacity() * sizeof(double) + m_meetings.capacity() * sizeof(Meeting) +
+                   (m_forwardTrees.capacity() + m_backwardTrees.capacity()) * sizeof(SearchTree) +
+                   m_pathTrees.capacity() * sizeof(PathTree);
+    for (const std::vector<SearchTree>* trees : {&m_forwardTrees, &m_backwardTrees}) {
+        for (const SearchTree& tree : *trees) {
+            bytes += tree.capacity() * sizeof(ContractionHierarchy::SearchTreeArc);
+        }
+    }
+    for (const PathTree& tree : m_pathTrees) {
+        bytes += tree.capacity() * sizeof(PathArc);
+    }
+    return bytes;
+}
+
+void RouteMatrix::clear() {
+    m_hierarchy = nullptr;
+    m_sources.clear();
+    m_destinations.clear();
+    m_forwardTrees.clear();
+    m_backwardTrees.clear();
+    m_times.clear();
+    m_meetings.clear();
+    m_pathTrees.clear();
+    m_settledArcs = 0;
+}
@@ -0,0 +1,79 @@
+#ifndef ROUTEMATRIX_H
+#define ROUTEMATRIX_H
+
+#include "StreetsDatabaseAPI.h"
+#include "contractionHierarchy.h"
+#include "searchState.h"
+#include <thread>
+#include <vector>
+
+class TaskGraph;
+
+//Fastest travel times from every source to every destination, for the courier solver and for
+//dispatch planning. With a contraction hierarchy for the turn penalty, compute runs one upward
+//search per source and per destination and meets them in per-arc buckets, so a few hundred
+//stops cost a few hundred small searches instead of a Dijkstra over the whole map each. The
+//search trees are kept, and a path is only unpacked when it is asked for; sweeps keep a tree
+//of their paths' arcs for the same reason.
+class RouteMatrix {
+public:
+    enum class Method {
+        Automatic,      //Buckets if the hierarchy is built already or routingEngine uses hierarchies, else Sweep
+        Buckets,        //builds the hierarchy for the turn penalty on first use, which takes a while
+        Sweep           //one Dijkstra per source, stopped once it has settled every destination
+    };
+
+    //Fills the matrix with the searches spread over numThreads workers; sources and destinations
+    //may repeat and may share intersections
+    void compute(const std::vector<IntersectionIdx>& sources, const std::vector<IntersectionIdx>& destinations, double turnPenalty,
+                 Method method = Method::Automatic, unsigned numThreads = std::thread::hardware_concurrency());
+
+    //Rows and columns are positions in compute's sources and destinations
+    int numSources() const { return static_cast<int>(m_sources.size()); }
+    int numDestinations() const { return static_cast<int>(m_destinations.size()); }
+    //kUnreachedTime if there is no path, 0 between an intersection and itself
+    double travelTime(int source, int destination) const { return m_times[cell(source, destination)]; }
+    bool reachable(int source, int destination) const { return travelTime(source, destination) < kUnreachedTime; }
+    //Street segments of the fastest path, as findPathBetweenIntersections returns them
+    std::vector<StreetSegmentIdx> path(int source, int destination) const;
+
+    //Arcs settled by all of compute's searches together
+    size_t settledArcs() const { return m_settledArcs; }
+    size_t memoryBytes() const;
+    void clear();
+
+private:
+    typedef std::vector<ContractionHierarchy::SearchTreeArc> SearchTree;
+
+    //Arc of a sweep's path tree; parent is the index of the arc before it, -1 at the source
+    struct PathArc {
+        int32_t arc;
+        int32_t parent;
+    };
+    typedef std::vector<PathArc> PathTree;
+
+    //Entries of the two search trees holding the arc the fastest path meets on, -1 if none.
+    //After a sweep, forward is the entry of the path's last arc in the source's path tree.
+    struct Meeting {
+        int32_t forward = -1;
+        int32_t backward = -1;
+    };
+
+    size_t cell(int source, int destination) const { return static_cast<size_t>(source) * m_destinations.size() + destination; }
+    void computeBuckets(TaskGraph& graph, int chunkSize);
+    void computeSweep(TaskGraph& graph, int chunkSize, double turnPenalty);
+
+    //nullptr after a sweep
+    const ContractionHierarchy* m_hierarchy = nullptr;
+    std::vector<IntersectionIdx> m_sources;
+    std::vector<IntersectionIdx> m_destinations;
+    std::vector<SearchTree> m_forwardTrees;         //one per source
+    std::vector<SearchTree> m_backwardTrees;        //one per destination
+    std::vector<double> m_times;                    //row-major, a row per source
+    std::vector<Meeting> m_meetings;
+    //one per source after a sweep: the union of its paths to the destinations, shared prefixes stored once
+    std::vector<PathTree> m_pathTrees;
+    size_t m_settledArcs = 0;
+};
+
+#endif //ROUTEMATRIX_H
@@ -0,0 +1,259 @@
+#include "routingBenchmark.h"
+#include "m3.h"
+#include "samiristhegoat.h"
+#include "contractionHierarchy.h"
+#include "routingContext.h"
+#include "routeBatch.h"
+#include "routeCache.h"
+#include "routeMatrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <queue>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct EngineRun {
+    const char* name;
+    RoutingEngine engine;
+};
+
+const EngineRun kEngines[] = {
+    {"A*", RoutingEngine::AStar},
+    {"A* with landmarks", RoutingEngine::ALT},
+    {"bidirectional A*", RoutingEngine::BidirectionalAStar},
+    {"contraction hierarchies", RoutingEngine::ContractionHierarchies},
+};
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+//Mean milliseconds per query of unidirectional A* on the given queue
+template <typename Queue>
+double meanQueueLatency(const std::vector<std::pair<IntersectionIdx, IntersectionIdx>>& queries, double turnPenalty) {
+    RoutingContext context;
+    Queue queue;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        context.searchTo(queue, query.first, query.second, turnPenalty, false);
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return queries.empty() ? 0 : milliseconds / queries.size();
+}
+
+//Drives the queue with random pushes, decrease-keys and pops the way a search does (keys
+//never drop below the last popped one) and replays them on std::priority_queue with lazy
+//deletion. Counts pops whose key is not the reference minimum or not the id's current key,
+//plus disagreements on empty(). Ties may pop in either order, so ids are not compared.
+template <typename Queue>
+int queueMismatches(unsigned seed) {
+    const int numIds = 2000;
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> anyId(0, numIds - 1);
+    std::uniform_real_distribution<double> unit(0, 1);
+    Queue queue;
+    queue.resize(numIds);
+    int mismatches = 0;
+    for (int round = 0; round < 3; round++) {
+        queue.clear();
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> reference;
+        std::vector<double> referenceKey(numIds);
+        std::vector<bool> queued(numIds, false);
+        int numQueued = 0;
+        double last = 0;
+        for (int operation = 0; operation < 50000 || numQueued > 0; operation++) {
+            if (operation < 50000 && unit(random) < 0.6) {
+                int id = anyId(random);
+                //whole-second keys tie often and share Dial buckets; larger keys for a queued id are ignored
+                double key = last + (unit(random) < 0.2 ? std::floor(unit(random) * 20) : unit(random) * 600);
+                if (queued[id] && unit(random) < 0.5) {
+                    key = last + (referenceKey[id] - last) * unit(random);
+                }
+                queue.push(id, key);
+                if (!queued[id]) {
+                    queued[id] = true;
+                    numQueued++;
+                    referenceKey[id] = key;
+                } else if (key < referenceKey[id]) {
+                    referenceKey[id] = key;
+                }
+                reference.push(Entry(referenceKey[id], id));
+                continue;
+            }
+            while (!reference.empty() && (!queued[reference.top().second] || referenceKey[reference.top().second] != reference.top().first)) {
+                reference.pop();
+            }
+            if (queue.empty() != reference.empty()) {
+                mismatches++;
+                break;
+            }
+            if (queue.empty()) {
+                continue;
+            }
+            int id = queue.top();
+            double key = queue.topKey();
+            if (key != reference.top().first || !queued[id] || referenceKey[id] != key) {
+                mismatches++;
+            }
+            queue.pop();
+            if (queued[id]) {
+                queued[id] = false;
+                numQueued--;
+            }
+            last = key;
+        }
+        if (!queue.empty()) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+} //namespace
+
+void runRoutingBenchmark(std::ostream& out, int numQueries, double turnPenalty, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<IntersectionIdx> intersection(0, getNumIntersections() - 1);
+    std::vector<std::pair<IntersectionIdx, IntersectionIdx>> queries(numQueries);
+    for (auto& query : queries) {
+        query.first = intersection(random);
+        query.second = intersection(random);
+    }
+
+    //the hierarchy is built once per turn penalty; time that separately from the queries
+    auto buildStart = std::chrono::steady_clock::now();
+    contractionHierarchies.forTurnPenalty(turnPenalty);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    //every search is timed; the route cache would answer repeats without one
+    size_t cacheCapacity = routeCache.capacity();
+    routeCache.setCapacity(0);
+    RoutingEngine previousEngine = routingEngine;
+    std::vector<double> referenceTimes(numQueries);
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "Routing benchmark: " << numQueries << " queries, turn penalty " << turnPenalty << "s, seed " << seed << std::endl;
+    out << std::left << std::setw(26) << "Engine" << std::right << std::setw(12) << "Mean(ms)" << std::setw(12) << "Median(ms)"
+        << std::setw(14) << "Settled" << std::setw(11) << "Mismatch" << std::endl;
+    for (const EngineRun& run : kEngines) {
+        setRoutingEngine(run.engine);
+        std::vector<double> latencies(numQueries);
+        double settled = 0;
+        int mismatches = 0;
+        for (int query = 0; query < numQueries; query++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<StreetSegmentIdx> path = findPathBetweenIntersections(queries[query], turnPenalty);
+            latencies[query] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            settled += threadRoutingContext().settledArcs();
+
+            double travelTime = path.empty() ? -1 : computePathTravelTime(path, turnPenalty);
+            if (run.engine == RoutingEngine::AStar) {
+                referenceTimes[query] = travelTime;
+            } else if (std::abs(travelTime - referenceTimes[query]) > 1e-6) {
+                mismatches++;
+            }
+        }
+        double meanLatency = 0;
+        for (double latency : latencies) {
+            meanLatency += latency;
+        }
+        out << std::left << std::setw(26) << run.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << (numQueries > 0 ? meanLatency / numQueries : 0) << std::setw(12) << median(latencies)
+            << std::setprecision(0) << std::setw(14) << (numQueries > 0 ? settled / numQueries : 0) << std::setw(11) << mismatches << std::endl;
+    }
+    out << "Contraction hierarchy build: " << std::setprecision(3) << buildSeconds << "s" << std::endl;
+    setRoutingEngine(previousEngine);
+
+    out << "A* mean(ms) by wavefront queue: 4-ary heap " << meanQueueLatency<IndexedQuadHeap>(queries, turnPenalty)
+        << ", radix heap " << meanQueueLatency<RadixHeap>(queries, turnPenalty) << ", Dial " << meanQueueLatency<DialQueue>(queries, turnPenalty) << std::endl;
+    out << "Wavefront queue mismatches against std::priority_queue: 4-ary heap " << queueMismatches<IndexedQuadHeap>(seed)
+        << ", radix heap " << queueMismatches<RadixHeap>(seed) << ", Dial " << queueMismatches<DialQueue>(seed) << std::endl;
+
+    //many-to-many between the queries' endpoints: Dijkstra per source stopped at the last
+    //destination, the hierarchy's buckets, and for scale Dijkstra over the whole map
+    const int matrixSide = std::min(numQueries, 100);
+    std::vector<IntersectionIdx> matrixSources, matrixDestinations;
+    for (int query = 0; query < matrixSide; query++) {
+        matrixSources.push_back(queries[query].first);
+        matrixDestinations.push_back(queries[query].second);
+    }
+    //mismatches: cells whose unpacked path does not take the cell's time, or whose time differs
+    //from the sweep's
+    RouteMatrix matrix;
+    std::vector<double> sweepTimes;
+    out << "Matrix " << matrixSide << "x" << matrixSide << " ms (settled arcs per source, mismatches):";
+    for (auto method : {std::make_pair(" sweep ", RouteMatrix::Method::Sweep), std::make_pair(", buckets ", RouteMatrix::Method::Buckets)}) {
+        auto start = std::chrono::steady_clock::now();
+        matrix.compute(matrixSources, matrixDestinations, turnPenalty, method.second);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        int mismatches = 0;
+        for (int source = 0; source < matrixSide; source++) {
+            for (int destination = 0; destination < matrixSide; destination++) {
+                double time = matrix.travelTime(source, destination);
+                std::vector<StreetSegmentIdx> path = matrix.path(source, destination);
+                if (!matrix.reachable(source, destination)) {
+                    mismatches += !path.empty();
+                } else if (std::abs((path.empty() ? 0 : computePathTravelTime(path, turnPenalty)) - time) > 1e-6) {
+                    mismatches++;
+                }
+                if (method.second == RouteMatrix::Method::Sweep) {
+                    sweepTimes.push_back(time);
+                } else if (time != sweepTimes[source * matrixSide + destination] &&
+                           std::abs(time - sweepTimes[source * matrixSide + destination]) > 1e-6) {
+                    mismatches++;
+                }
+            }
+        }
+        out << method.first << std::setprecision(3) << milliseconds << std::setprecision(0) << " ("
+            << (matrixSide > 0 ? matrix.settledArcs() / matrixSide : 0) << ", " << mismatches << ")";
+    }
+    size_t wholeMapSettled = 0;
+    for (IntersectionIdx source : matrixSources) {
+        threadRoutingContext().searchAll(source, turnPenalty);
+        wholeMapSettled += threadRoutingContext().settledArcs();
+    }
+    out << ", whole map (" << (matrixSide > 0 ? wholeMapSettled / matrixSide : 0) << ")" << std::endl;
+
+    //batch throughput of the configured engine, single-threaded and on every core
+    std::vector<RouteQuery> batch(numQueries);
+    for (int query = 0; query < numQueries; query++) {
+        batch[query] = {queries[query].first, queries[query].second, turnPenalty};
+    }
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        auto start = std::chrono::steady_clock::now();
+        findPathsBatch(batch, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        out << "Batch throughput on " << threads << (threads == 1 ? " thread: " : " threads: ") << std::setprecision(0)
+            << (seconds > 0 ? numQueries / seconds : 0) << " queries/s" << std::endl;
+    }
+
+    //the same batch twice through the route cache; the second pass should be all hits
+    routeCache.setCapacity(std::max<size_t>(cacheCapacity, numQueries));
+    RouteCache::Statistics before = routeCache.statistics();
+    findPathsBatch(batch);
+    auto start = std::chrono::steady_clock::now();
+    findPathsBatch(batch);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RouteCache::Statistics after = routeCache.statistics();
+    out << "Cached batch throughput: " << (seconds > 0 ? numQueries / seconds : 0) << " queries/s, " << after.hits - before.hits << " hits, "
+        << after.misses - before.misses << " misses" << std::endl;
+    routeCache.setCapacity(cacheCapacity);
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,17 @@
+#ifndef ROUTINGBENCHMARK_H
+#define ROUTINGBENCHMARK_H
+
+#include <iostream>
+
+//Runs the same random intersection pairs through every routing engine and prints, per engine,
+//the mean and median latency, the mean number of settled arcs and how many answers differ in
+//travel time from unidirectional A*. Needs a loaded map; the query set depends only on the
+//seed and the map, so runs are comparable across builds. The routing engine is restored afterwards,
+//then A* is timed on each wavefront queue and each queue is checked against std::priority_queue
+//on random push/decrease-key/pop sequences (any mismatch is a queue bug). The many-to-many
+//matrix is timed as a sweep and with buckets, counting cells whose time differs from the sweep's
+//or from that of the cell's own unpacked path. Last, the same queries go through findPathsBatch
+//on one thread, on every core and twice through the route cache. The cache is bypassed until then.
+void runRoutingBenchmark(std::ostream& out, int numQueries, double turnPenalty, unsigned seed = 297);
+
+#endif //ROUTINGBENCHMARK_H
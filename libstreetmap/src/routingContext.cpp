@@ -0,0 +1,333 @@
+#include "routingContext.h"
+#include "m1.h"
+#include "samiristhegoat.h"
+#include "edgeBasedGraph.h"
+#include "landmarks.h"
+#include "heuristicGeometry.h"
+#include <algorithm>
+#include <list>
+#include <mutex>
+
+namespace {
+
+//Empties a queue left over from the last search, or sizes it for the loaded map
+template <typename Queue>
+void startQueue(Queue& queue) {
+    if (queue.numIds() != edgeBasedGraph.numArcs()) {
+        queue.resize(edgeBasedGraph.numArcs());
+    } else {
+        queue.clear();
+    }
+}
+
+std::mutex contextPoolLock;
+std::vector<std::unique_ptr<RoutingContext>> contextPool;
+
+} //namespace
+
+RoutingContext& threadRoutingContext() {
+    thread_local RoutingContext context;
+    return context;
+}
+
+std::unique_ptr<RoutingContext> acquirePooledRoutingContext() {
+    std::lock_guard<std::mutex> guard(contextPoolLock);
+    if (contextPool.empty()) {
+        return std::unique_ptr<RoutingContext>(new RoutingContext());
+    }
+    std::unique_ptr<RoutingContext> context = std::move(contextPool.back());
+    contextPool.pop_back();
+    return context;
+}
+
+void releasePooledRoutingContext(std::unique_ptr<RoutingContext> context) {
+    std::lock_guard<std::mutex> guard(contextPoolLock);
+    contextPool.push_back(std::move(context));
+}
+
+void releaseRoutingContextPool() {
+    std::lock_guard<std::mutex> guard(contextPoolLock);
+    contextPool.clear();
+}
+
+void RoutingContext::prepare() {
+    if (m_nodes.size() != static_cast<size_t>(getNumIntersections())) {
+        m_nodes.resize(getNumIntersections());
+    }
+    if (m_arcs.size() != static_cast<size_t>(edgeBasedGraph.numArcs())) {
+        m_arcs.resize(edgeBasedGraph.numArcs());
+    }
+}
+
+std::vector<StreetSegmentIdx> RoutingContext::findPath(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, RoutingEngine engine) {
+    if (engine == RoutingEngine::ContractionHierarchies) {
+        //the hierarchy for this turn penalty is built by the first query that needs it
+        std::vector<StreetSegmentIdx> path = contractionHierarchies.forTurnPenalty(turnPenalty).findPath(source, destination, m_hierarchyScratch);
+        m_settledArcs = m_hierarchyScratch.settledArcs();
+        return path;
+    }
+    if (engine == RoutingEngine::BidirectionalAStar) {
+        return bidirectionalPath(source, destination, turnPenalty);
+    }
+    if (searchTo(source, destination, turnPenalty, engine == RoutingEngine::ALT)) {
+        return traceBack(destination);
+    }
+    return {};
+}
+
+template <typename Queue>
+bool RoutingContext::searchTo(Queue& queue, IntersectionIdx source, IntersectionIdx destination, double turnPenalty, bool useLandmarks) {
+    prepare();
+    startQueue(queue);
+    //every node and arc reads as unreached again, without touching the whole arrays
+    m_nodes.beginQuery();
+    m_arcs.beginQuery();
+    m_nodes.settle(source, 0, SOURCE_EDGE);
+    m_settledArcs = 0;
+    if (source == destination) {
+        return true;
+    }
+    HeuristicGeometry::Point target = heuristicGeometry.position(destination);
+    //lower bound on the time left from an intersection; with landmarks their bound takes over
+    //wherever it is stronger than the crow-flies bound (both are admissible, so is their max)
+    auto timeLeft = [&](IntersectionIdx node) {
+        double asTheCrowFlies = heuristicGeometry.timeBetween(node, target);
+        return useLandmarks ? std::max(asTheCrowFlies, landmarkTable.lowerBound(node, destination)) : asTheCrowFlies;
+    };
+    auto relax = [&](ArcIdx arc, ArcIdx from, double time) {
+        if (time < m_arcs.bestTime(arc)) {
+            m_arcs.settle(arc, time, from);
+            queue.push(arc, time + timeLeft(edgeBasedGraph.head(arc)));
+        }
+    };
+    //the wavefront starts with every arc leaving the source, no turn penalty on the first segment
+    for (ArcIdx arc : edgeBasedGraph.departures(source)) {
+        relax(arc, SOURCE_EDGE, edgeBasedGraph.travelTime(arc));
+    }
+    while (!queue.empty()) {
+        ArcIdx arc = queue.top();
+        queue.pop();
+        double time = m_arcs.bestTime(arc);
+        m_settledArcs++;
+        //arcs into one intersection share the heuristic, so the first one settled is the fastest
+        IntersectionIdx head = edgeBasedGraph.head(arc);
+        if (!m_nodes.reached(head)) {
+            m_nodes.settle(head, time, arc);
+        }
+        if (head == destination) {
+            return true;
+        }
+        //each transition already knows whether the street changes
+        for (ArcTransition transition : edgeBasedGraph.transitionsOf(arc)) {
+            relax(transition.arc(), arc, time + edgeBasedGraph.cost(transition, turnPenalty));
+        }
+    }
+    return false;
+}
+
+template <typename Queue>
+void RoutingContext::searchAll(Queue& queue, IntersectionIdx source, double turnPenalty) {
+    sweep(queue, source, turnPenalty, nullptr, kUnreachedTime);
+}
+
+int RoutingContext::searchTargets(IntersectionIdx source, const std::vector<IntersectionIdx>& targets, double turnPenalty, double maxTime) {
+    return sweep(m_queue, source, turnPenalty, &targets, maxTime);
+}
+
+template <typename Queue>
+int RoutingContext::sweep(Queue& queue, IntersectionIdx source, double turnPenalty, const std::vector<IntersectionIdx>* targets, double maxTime) {
+    prepare();
+    startQueue(queue);
+    m_nodes.beginQuery();
+    m_arcs.beginQuery();
+    m_nodes.settle(source, 0, SOURCE_EDGE);
+    m_settledArcs = 0;
+
+    //targets repeat in courier instances, so count each intersection once
+    int targetsLeft = 0;
+    int targetsReached = 0;
+    if (targets != nullptr) {
+        m_targetBits.resize((getNumIntersections() + 63) / 64);
+        for (IntersectionIdx target : *targets) {
+            uint64_t bit = uint64_t(1) << (target % 64);
+            if (target == source) {
+                targetsReached = 1;
+            } else if (!(m_targetBits[target / 64] & bit)) {
+                m_targetBits[target / 64] |= bit;
+                targetsLeft++;
+            }
+        }
+        if (targetsLeft == 0) {
+            return targetsReached;
+        }
+    }
+
+    auto relax = [&](ArcIdx arc, ArcIdx from, double time) {
+        if (time < m_arcs.bestTime(arc)) {
+            m_arcs.settle(arc, time, from);
+            queue.push(arc, time);
+        }
+    };
+    for (ArcIdx arc : edgeBasedGraph.departures(source)) {
+        relax(arc, SOURCE_EDGE, edgeBasedGraph.travelTime(arc));
+    }
+    while (!queue.empty()) {
+        ArcIdx arc = queue.top();
+        queue.pop();
+        double time = m_arcs.bestTime(arc);
+        if (time > maxTime) {
+            break;
+        }
+        m_settledArcs++;
+        //the first arc settled into an intersection is its fastest arrival
+        IntersectionIdx head = edgeBasedGraph.head(arc);
+        if (!m_nodes.reached(head)) {
+            m_nodes.settle(head, time, arc);
+            if (targets != nullptr && (m_targetBits[head / 64] >> (head % 64) & 1)) {
+                m_targetBits[head / 64] &= ~(uint64_t(1) << (head % 64));
+                targetsReached++;
+                if (--targetsLeft == 0) {
+                    return targetsReached;
+                }
+            }
+        }
+        for (ArcTransition transition : edgeBasedGraph.transitionsOf(arc)) {
+            relax(transition.arc(), arc, time + edgeBasedGraph.cost(transition, turnPenalty));
+        }
+    }
+    //unreachable targets (or ones past maxTime) are still marked; clear them for the next search
+    if (targets != nullptr) {
+        for (IntersectionIdx target : *targets) {
+            m_targetBits[target / 64] &= ~(uint64_t(1) << (target % 64));
+        }
+    }
+    return targetsReached;
+}
+
+template bool RoutingContext::searchTo(IndexedQuadHeap&, IntersectionIdx, IntersectionIdx, double, bool);
+template bool RoutingContext::searchTo(RadixHeap&, IntersectionIdx, IntersectionIdx, double, bool);
+template bool RoutingContext::searchTo(DialQueue&, IntersectionIdx, IntersectionIdx, double, bool);
+template void RoutingContext::searchAll(IndexedQuadHeap&, IntersectionIdx, double);
+template void RoutingContext::searchAll(RadixHeap&, IntersectionIdx, double);
+template void RoutingContext::searchAll(DialQueue&, IntersectionIdx, double);
+
+std::vector<StreetSegmentIdx> RoutingContext::traceBack(IntersectionIdx destination) const {
+    //unreached destinations have no path (their reaching arcs are left over from older queries)
+    if (!m_nodes.reached(destination)) {
+        return {};
+    }
+    //walk the arcs back from the one that reached the destination to one leaving the source
+    std::list<StreetSegmentIdx> path;
+    for (ArcIdx arc = m_nodes.reachingEdge(destination); arc != SOURCE_EDGE; arc = m_arcs.reachingEdge(arc)) {
+        path.push_front(EdgeBasedGraph::segmentOf(arc));
+    }
+    return std::vector<StreetSegmentIdx>(path.begin(), path.end());
+}
+
+// Bidirectional A* over the edge-based graph. Both halves use the average potential
+// p(arc) = (crow-flies time to destination - crow-flies time from source) / 2 at the arc's head,
+// forward keys are time + p and backward keys time - p, so both searches see the same
+// nonnegative reduced costs and the search can stop once the two smallest keys add up to the
+// best meeting found. The forward time of an arc includes the arc, the backward time covers
+// everything after it, turn penalties included, so a meeting arc's two times add up exactly.
+std::vector<StreetSegmentIdx> RoutingContext::bidirectionalPath(IntersectionIdx source, IntersectionIdx destination, double turnPenalty) {
+    m_settledArcs = 0;
+    if (source == destination) {
+        return {};
+    }
+    prepare();
+    if (m_backwardArcs.size() != m_arcs.size()) {
+        m_backwardArcs.resize(static_cast<int>(m_arcs.size()));
+    }
+    startQueue(m_forwardQueue);
+    startQueue(m_backwardQueue);
+    m_arcs.beginQuery();
+    m_backwardArcs.beginQuery();
+    HeuristicGeometry::Point sourcePoint = heuristicGeometry.position(source);
+    HeuristicGeometry::Point destinationPoint = heuristicGeometry.position(destination);
+    auto potential = [&](ArcIdx arc) {
+        IntersectionIdx head = edgeBasedGraph.head(arc);
+        return 0.5 * (static_cast<double>(heuristicGeometry.timeBetween(head, destinationPoint)) - heuristicGeometry.timeBetween(head, sourcePoint));
+    };
+
+    double bestTime = kUnreachedTime;
+    ArcIdx meetingArc = SOURCE_EDGE;
+    //labels are written when an arc is pushed so either side can spot a meeting as soon as it happens
+    auto relax = [&](SearchState& labels, const SearchState& otherLabels, IndexedQuadHeap& queue, ArcIdx arc, ArcIdx from, double time, double key) {
+        if (time >= labels.bestTime(arc)) {
+            return;
+        }
+        labels.settle(arc, time, from);
+        queue.push(arc, key);
+        if (otherLabels.reached(arc) && time + otherLabels.bestTime(arc) < bestTime) {
+            bestTime = time + otherLabels.bestTime(arc);
+            meetingArc = arc;
+        }
+    };
+    for (ArcIdx arc : edgeBasedGraph.departures(source)) {
+        relax(m_arcs, m_backwardArcs, m_forwardQueue, arc, SOURCE_EDGE, edgeBasedGraph.travelTime(arc), edgeBasedGraph.travelTime(arc) + potential(arc));
+    }
+    for (ArcIdx arc : edgeBasedGraph.arrivals(destination)) {
+        relax(m_backwardArcs, m_arcs, m_backwardQueue, arc, SOURCE_EDGE, 0, -potential(arc));
+    }
+
+    //once either side runs dry every path it could still close has already been seen by the other
+    while (!m_forwardQueue.empty() && !m_backwardQueue.empty()) {
+        if (m_forwardQueue.topKey() + m_backwardQueue.topKey() >= bestTime) {
+            break;
+        }
+        bool forward = m_forwardQueue.topKey() <= m_backwardQueue.topKey();
+        IndexedQuadHeap& queue = forward ? m_forwardQueue : m_backwardQueue;
+        SearchState& labels = forward ? m_arcs : m_backwardArcs;
+        SearchState& otherLabels = forward ? m_backwardArcs : m_arcs;
+        ArcIdx arc = queue.top();
+        queue.pop();
+        double arcTime = labels.bestTime(arc);
+        m_settledArcs++;
+        if (forward) {
+            for (ArcTransition transition : edgeBasedGraph.transitionsOf(arc)) {
+                double time = arcTime + edgeBasedGraph.cost(transition, turnPenalty);
+                relax(labels, otherLabels, queue, transition.arc(), arc, time, time + potential(transition.arc()));
+            }
+        } else {
+            //walking a transition backwards still costs entering the arc we came from
+            for (ArcTransition transition : edgeBasedGraph.reverseTransitionsOf(arc)) {
+                double time = arcTime + edgeBasedGraph.enterCost(arc, transition.turn(), turnPenalty);
+                relax(labels, otherLabels, queue, transition.arc(), arc, time, time - potential(transition.arc()));
+            }
+        }
+    }
+    if (meetingArc == SOURCE_EDGE) {
+        return {};
+    }
+
+    //forward parents lead back to the source, backward parents on to the destination
+    std::list<StreetSegmentIdx> path;
+    for (ArcIdx arc = meetingArc; arc != SOURCE_EDGE; arc = m_arcs.reachingEdge(arc)) {
+        path.push_front(EdgeBasedGraph::segmentOf(arc));
+    }
+    for (ArcIdx arc = m_backwardArcs.reachingEdge(meetingArc); arc != SOURCE_EDGE; arc = m_backwardArcs.reachingEdge(arc)) {
+        path.push_back(EdgeBasedGraph::segmentOf(arc));
+    }
+    return std::vector<StreetSegmentIdx>(path.begin(), path.end());
+}
+
+size_t RoutingContext::memoryBytes() const {
+    //every member reports its own size, so only the counter is left
+    return sizeof(m_settledArcs) + m_nodes.memoryBytes() + m_arcs.memoryBytes() + m_backwardArcs.memoryBytes() + m_queue.memoryBytes() +
+           m_forwardQueue.memoryBytes() + m_backwardQueue.memoryBytes() + m_hierarchyScratch.memoryBytes() +
+           m_targetBits.capacity() * sizeof(uint64_t);
+}
+
+void RoutingContext::clear() {
+    m_nodes.clear();
+    m_arcs.clear();
+    m_backwardArcs.clear();
+    m_queue.resize(0);
+    m_forwardQueue.resize(0);
+    m_backwardQueue.resize(0);
+    m_hierarchyScratch.clear();
+    m_targetBits.clear();
+    m_targetBits.shrink_to_fit();
+    m_settledArcs = 0;
+}
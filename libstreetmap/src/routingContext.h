@@ -0,0 +1,102 @@
+#ifndef ROUTINGCONTEXT_H
+#define ROUTINGCONTEXT_H
+
+#include "StreetsDatabaseAPI.h"
+#include "searchState.h"
+#include "edgeBasedGraph.h"
+#include "contractionHierarchy.h"
+#include "wavefrontQueue.h"
+#include <memory>
+#include <vector>
+
+enum class RoutingEngine {
+   AStar,                      //A* on the edge-based graph
+   ALT,                        //A* with landmark lower bounds on top of the crow-flies heuristic
+   BidirectionalAStar,         //A* from both ends with the average potential
+   ContractionHierarchies      //exact in the turn-penalty metric, hierarchy built once per turn penalty
+};
+
+//Queue behind searchTo and searchAll; RadixHeap and DialQueue (wavefrontQueue.h) are drop-in
+//alternatives. The bidirectional search always uses IndexedQuadHeap, its keys can be negative.
+typedef IndexedQuadHeap WavefrontQueue;
+
+//Scratch space of one routing query at a time. The edge-based graph, landmark tables and
+//contraction hierarchies are read-only after loadMap and shared by every context, so threads
+//can route concurrently on one loaded map as long as each uses its own context.
+class RoutingContext {
+public:
+    //Sizes the scratch for the loaded map; the queries call this themselves
+    void prepare();
+
+    //Fastest path from source to destination with the given engine; empty if there is none
+    //or source == destination
+    std::vector<StreetSegmentIdx> findPath(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, RoutingEngine engine);
+
+    //A* from source that stops once destination is settled; false if it cannot be reached.
+    //Read the result with travelTime and traceBack.
+    bool searchTo(IntersectionIdx source, IntersectionIdx destination, double turnPenalty, bool useLandmarks) {
+        return searchTo(m_queue, source, destination, turnPenalty, useLandmarks);
+    }
+    //Dijkstra from source over every reachable intersection
+    void searchAll(IntersectionIdx source, double turnPenalty) { searchAll(m_queue, source, turnPenalty); }
+    //Dijkstra from source that stops once every target it can reach is settled, or once it is
+    //more than maxTime away from the source; returns how many distinct targets were settled.
+    //Intersections it stopped short of read as unreached.
+    int searchTargets(IntersectionIdx source, const std::vector<IntersectionIdx>& targets, double turnPenalty, double maxTime = kUnreachedTime);
+
+    //The same searches on a caller's queue, to compare queues; instantiated for the three in wavefrontQueue.h
+    template <typename Queue>
+    bool searchTo(Queue& queue, IntersectionIdx source, IntersectionIdx destination, double turnPenalty, bool useLandmarks);
+    template <typename Queue>
+    void searchAll(Queue& queue, IntersectionIdx source, double turnPenalty);
+
+    //Results of the last searchTo / searchAll
+    bool reached(IntersectionIdx intersection) const { return m_nodes.reached(intersection); }
+    double travelTime(IntersectionIdx intersection) const { return m_nodes.bestTime(intersection); }
+    std::vector<StreetSegmentIdx> traceBack(IntersectionIdx destination) const;
+    //The same path one arc at a time, for callers keeping it in their own form: the arc that
+    //reached a reached intersection, and the arc before any arc on it (SOURCE_EDGE at the source)
+    ArcIdx reachingArc(IntersectionIdx intersection) const { return m_nodes.reachingEdge(intersection); }
+    ArcIdx previousArc(ArcIdx arc) const { return m_arcs.reachingEdge(arc); }
+
+    //Hierarchy scratch of this context, for searches outside findPath such as RouteMatrix
+    ContractionHierarchy::Scratch& hierarchyScratch() { return m_hierarchyScratch; }
+
+    //Arcs settled by the last query, whichever engine ran it
+    size_t settledArcs() const { return m_settledArcs; }
+    size_t memoryBytes() const;
+    void clear();
+
+private:
+    //searchAll without targets, searchTargets with them
+    template <typename Queue>
+    int sweep(Queue& queue, IntersectionIdx source, double turnPenalty, const std::vector<IntersectionIdx>* targets, double maxTime);
+    std::vector<StreetSegmentIdx> bidirectionalPath(IntersectionIdx source, IntersectionIdx destination, double turnPenalty);
+
+    //reachingEdge is the arc that first arrived at an intersection
+    SearchState m_nodes;
+    //reachingEdge is the previous arc; labels are written when an arc is queued, and are final
+    //once it is popped
+    SearchState m_arcs;
+    //backward half of the bidirectional search, reachingEdge is the next arc; sized on first use
+    SearchState m_backwardArcs;
+    WavefrontQueue m_queue;
+    IndexedQuadHeap m_forwardQueue;
+    IndexedQuadHeap m_backwardQueue;
+    ContractionHierarchy::Scratch m_hierarchyScratch;
+    //one bit per intersection, set only for the targets searchTargets has not settled yet
+    std::vector<uint64_t> m_targetBits;
+    size_t m_settledArcs = 0;
+};
+
+//Context of the calling thread, behind the free routing functions of m3 and m4
+RoutingContext& threadRoutingContext();
+
+//Contexts for TaskGraph workers, which are new threads in every run: a worker takes one for its
+//chunk and hands it back, so the scratch outlives the threads. Safe to call from any thread.
+std::unique_ptr<RoutingContext> acquirePooledRoutingContext();
+void releasePooledRoutingContext(std::unique_ptr<RoutingContext> context);
+//Frees the pooled contexts; closeMap calls this
+void releaseRoutingContextPool();
+
+#endif //ROUTINGCONTEXT_H
@@ -11,6 +11,11 @@
 #include <list>
 #include <queue>
 #include "LatLon.h"
+#include "osmTagStore.h"
+#include "spatialIndex.h"
+#include "searchState.h"
+#include "edgeBasedGraph.h"
+#include "routingContext.h"
 
 #define BIGNUMBER 0x3F3F3F3F
 #define SOURCE_EDGE -1
@@ -69,62 +74,60 @@ struct poiTypeFilterBool {
    bool Public = false;
    bool All = false;
 };
-struct WaveElem {
-   IntersectionIdx nodeID;
-   StreetSegmentIdx edgeID;
-   double travelTime;
-   double totalTimeEstimation;
-   WaveElem(int n, int e, double time, double timeEstimation){
-      nodeID = n;
-      edgeID = e;
-      travelTime = time;
-      totalTimeEstimation = timeEstimation;
-   }
+//What a courier stop is for; one intersection can be a pick-up and a drop-off at once
+enum StopRole : uint8_t {
+   PickUpStop = 1,
+   DropOffStop = 2,
+   DepotStop = 4
 };
-struct Node {
-   double bestTime = BIGNUMBER;
-   StreetSegmentIdx reachingEdge;
+//Every distinct intersection of a courier problem under a compact stop id, with the travel
+//times between stops in one row-major float matrix
+struct CourierMatrix {
+   std::vector<IntersectionIdx> intersections;     //by stop id
+   std::vector<uint8_t> roles;                     //StopRole bits by stop id
+   std::vector<int> pickUpStops;                   //by delivery
+   std::vector<int> dropOffStops;                  //by delivery
+   std::vector<int> depotStops;                    //by depot
+   std::vector<float> times;                       //infinity where there is no path
 
-};
-struct timeWaveElemComparator {
-   bool operator()(const WaveElem& a, const WaveElem& b) const {
-      return std::greater<double>()(a.totalTimeEstimation, b.totalTimeEstimation);
-   }
-};
-struct CourierPath {
-   CourierSubPath courierSubPath;
-   double subPathTime;
-   std::string destType;
-}; 
-struct DeliveryInfBool{
-    //The intersection id where the item-to-be-delivered is picked-up.
-    IntersectionIdx pickUp;
-    bool pickUpBool = false;
-    //The intersection id where the item-to-be-delivered is dropped-off.
-    IntersectionIdx dropOff;
-    bool dropOffBool = false;
+   int numStops() const { return intersections.size(); }
+   const float* timesFrom(int stop) const { return &times[static_cast<size_t>(stop) * intersections.size()]; }
 };
 double x_from_lon(float lon);
 double y_from_lat(float lat);
 double lon_from_x(float x);
 double lat_from_y(float y);
 bool areaCompare(featureStruct f1, featureStruct f2);
-std::string getOSMWayTagValue(OSMID wayOSMID, std::string key);
+std::string_view getOSMWayTagValue(OSMID wayOSMID, std::string_view key);
+std::vector<StreetIdx> findStreetIdsFromPartialStreetName(std::string street_prefix, int maxResults);
+std::vector<IntersectionIdx> findClosestIntersections(LatLon my_position, int k);
+std::vector<IntersectionIdx> findIntersectionsWithinRadius(LatLon my_position, double radius);
+std::vector<POIIdx> findClosestPOIs(LatLon my_position, std::string POItype, int k);
+std::vector<POIIdx> findPOIsWithinRadius(LatLon my_position, std::string POItype, double radius);
+void setRoutingEngine(RoutingEngine engine);
+std::vector<StreetSegmentIdx> findDisplayedPath(const std::pair<IntersectionIdx, IntersectionIdx> intersect_ids, const double turn_penalty);
+std::vector <StreetSegmentIdx> bfsTraceBack (int destID);
+std::vector <StreetSegmentIdx> bidirectionalPath(IntersectionIdx srcID, IntersectionIdx destID, const double turn_penalty);
 void displayPath(std::vector <StreetSegmentIdx> streetSegmentPathVector, ezgl::renderer *g);
 
 
 
 
 extern std::vector<Intersection_data> intersections_xyposname;
+extern std::vector <std::vector <StreetSegmentIdx>> street_street_segments;
+extern std::vector <std::vector <double>> street_lengths;
+extern std::vector<double> street_segment_length;
 extern ezgl::application* applicationPtr;
-extern std::unordered_map< OSMID , std::vector <std::pair<std::string, std::string>>>OSMNodesandTags;
-extern std::unordered_map< OSMID , std::vector <std::pair<std::string, std::string>>>OSMWaysandTags;
+extern OSMTagStore OSMNodesandTags;
+extern OSMTagStore OSMWaysandTags;
 extern std::vector <std::vector <ezgl::point2d>> streetSegmentIdx_point2dxyCurvepoints;
 extern std::vector<StreetSegmentInfo> street_segment_info;
 extern std::vector<POI_data> poi_information;
 extern std::vector <featureStruct> Features;
 extern std::vector <int> cityIndexes;
-extern std::vector <Node> nodes;
+extern SpatialIndex intersectionSpatialIndex;
+extern CategorySpatialIndex poiSpatialIndex;
+extern RoutingEngine routingEngine;
 extern std::vector <bool> pathGlobalBool;
 extern std::vector <StreetSegmentIdx> pathGlobal;
 extern double max_lat;
@@ -0,0 +1,27 @@
+#include "searchState.h"
+
+void SearchState::resize(int numNodes) {
+    m_nodes.assign(numNodes, Node());
+    m_epoch = 0;
+}
+
+void SearchState::beginQuery() {
+    m_epoch++;
+    //after a wrap-around old stamps could look current again, so pay for one full reset
+    if (m_epoch == 0) {
+        for (Node& node : m_nodes) {
+            node.epoch = 0;
+        }
+        m_epoch = 1;
+    }
+}
+
+size_t SearchState::memoryBytes() const {
+    return sizeof(SearchState) + m_nodes.capacity() * sizeof(Node);
+}
+
+void SearchState::clear() {
+    m_nodes.clear();
+    m_nodes.shrink_to_fit();
+    m_epoch = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef SEARCHSTATE_H
+#define SEARCHSTATE_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <vector>
+
+//Best time of a node the current query has not reached (same value as BIGNUMBER)
+constexpr double kUnreachedTime = 0x3F3F3F3F;
+
+struct Node {
+    double bestTime;
+    StreetSegmentIdx reachingEdge;
+    uint32_t epoch = 0;         //query that last wrote this node; older values are stale
+};
+
+//Per-intersection routing state stamped with a query epoch. beginQuery() makes every node
+//read as unreached in O(1), so a search only pays for the nodes it actually visits.
+class SearchState {
+public:
+    void resize(int numNodes);
+    //Starts a new query; call once before each search
+    void beginQuery();
+
+    bool reached(IntersectionIdx node) const { return m_nodes[node].epoch == m_epoch; }
+    double bestTime(IntersectionIdx node) const { return reached(node) ? m_nodes[node].bestTime : kUnreachedTime; }
+    //Only meaningful for reached nodes
+    StreetSegmentIdx reachingEdge(IntersectionIdx node) const { return m_nodes[node].reachingEdge; }
+    void settle(IntersectionIdx node, double time, StreetSegmentIdx edge) {
+        Node& state = m_nodes[node];
+        state.bestTime = time;
+        state.reachingEdge = edge;
+        state.epoch = m_epoch;
+    }
+
+    size_t size() const { return m_nodes.size(); }
+    size_t memoryBytes() const;
+    void clear();
+
+private:
+    std::vector<Node> m_nodes;
+    uint32_t m_epoch = 0;
+};
+
+#endif //SEARCHSTATE_H
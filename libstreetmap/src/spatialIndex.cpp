@@ -0,0 +1,275 @@
+#include "spatialIndex.h"
+#include "m1.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+//Ranges this small are scanned instead of split further
+const int kLeafSize = 8;
+//Keeps the pruning bounds below the true distance despite rounding in the cosine
+const double kBoundSlack = 1 - 1e-9;
+
+struct Candidate {
+    double distance;
+    int id;
+};
+
+//Closer first; equal distances prefer the larger id
+bool closer(const Candidate& a, const Candidate& b) {
+    return a.distance < b.distance || (a.distance == b.distance && a.id > b.id);
+}
+
+struct NearestQuery {
+    Candidate best{std::numeric_limits<double>::infinity(), -1};
+    double bound() const { return best.distance; }
+    void consider(const Candidate& candidate) {
+        if (closer(candidate, best)) {
+            best = candidate;
+        }
+    }
+};
+
+struct KNearestQuery {
+    explicit KNearestQuery(size_t count) : k(count) {}
+    size_t k;
+    std::vector<Candidate> heap;        //max-heap on closer(), so the front is the worst kept candidate
+    double bound() const {
+        return heap.size() < k ? std::numeric_limits<double>::infinity() : heap.front().distance;
+    }
+    void consider(const Candidate& candidate) {
+        if (heap.size() < k) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end(), closer);
+        } else if (closer(candidate, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), closer);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end(), closer);
+        }
+    }
+};
+
+struct RadiusQuery {
+    explicit RadiusQuery(double radius) : radiusMeters(radius) {}
+    double radiusMeters;
+    std::vector<Candidate> found;
+    double bound() const { return radiusMeters; }
+    void consider(const Candidate& candidate) {
+        if (candidate.distance <= radiusMeters) {
+            found.push_back(candidate);
+        }
+    }
+};
+
+std::vector<int> sortedIds(std::vector<Candidate>& candidates) {
+    std::sort(candidates.begin(), candidates.end(), closer);
+    std::vector<int> ids;
+    ids.reserve(candidates.size());
+    for (const Candidate& candidate : candidates) {
+        ids.push_back(candidate.id);
+    }
+    return ids;
+}
+
+} //namespace
+
+void SpatialIndex::build(const std::vector<LatLon>& positions, const std::vector<int>& ids) {
+    m_points.resize(positions.size());
+    m_latitudeRange.assign({90, -90});
+    double latitudeSum = 0;
+    for (size_t point = 0; point < positions.size(); point++) {
+        m_points[point].latitude = positions[point].latitude();
+        m_points[point].longitude = positions[point].longitude();
+        m_points[point].id = ids.empty() ? point : ids[point];
+        m_points[point].axis = 0;
+        m_latitudeRange[0] = std::min(m_latitudeRange[0], m_points[point].latitude);
+        m_latitudeRange[1] = std::max(m_latitudeRange[1], m_points[point].latitude);
+        latitudeSum += m_points[point].latitude;
+    }
+    double cosine = positions.empty() ? 1 : std::cos(latitudeSum / positions.size() * kDegreeToRadian);
+
+    //split every range at its median along the wider side (in metres), then recurse into both halves
+    std::vector<std::pair<int, int>> ranges = {{0, static_cast<int>(m_points.size())}};
+    while (!ranges.empty()) {
+        int begin = ranges.back().first;
+        int end = ranges.back().second;
+        ranges.pop_back();
+        if (end - begin <= kLeafSize) {
+            continue;
+        }
+        float minLat = 90, maxLat = -90, minLon = 180, maxLon = -180;
+        for (int point = begin; point < end; point++) {
+            minLat = std::min(minLat, m_points[point].latitude);
+            maxLat = std::max(maxLat, m_points[point].latitude);
+            minLon = std::min(minLon, m_points[point].longitude);
+            maxLon = std::max(maxLon, m_points[point].longitude);
+        }
+        int axis = (maxLon - minLon) * cosine > (maxLat - minLat) ? 1 : 0;
+        int middle = begin + (end - begin) / 2;
+        std::nth_element(m_points.begin() + begin, m_points.begin() + middle, m_points.begin() + end, [axis](const Point& a, const Point& b) {
+            return axis == 0 ? a.latitude < b.latitude : a.longitude < b.longitude;
+        });
+        m_points[middle].axis = axis;
+        ranges.emplace_back(begin, middle);
+        ranges.emplace_back(middle + 1, end);
+    }
+}
+
+//Metres per radian of longitude can be no smaller than this for any pair of the query and a point,
+//because the metric uses the cosine of the average of the two latitudes
+double SpatialIndex::longitudeScaleFor(LatLon position) const {
+    double lowest = std::min<double>(position.latitude(), m_latitudeRange[0]);
+    double highest = std::max<double>(position.latitude(), m_latitudeRange[1]);
+    double extreme = std::min(90.0, std::max(std::abs(lowest), std::abs(highest)));
+    return kEarthRadiusInMeters * std::cos(extreme * kDegreeToRadian) * kBoundSlack;
+}
+
+template <typename Query>
+void SpatialIndex::search(int begin, int end, LatLon position, double longitudeScale, Query& query) const {
+    if (end - begin <= kLeafSize) {
+        for (int point = begin; point < end; point++) {
+            LatLon pointPosition(m_points[point].latitude, m_points[point].longitude);
+            query.consider(Candidate{findDistanceBetweenTwoPoints(position, pointPosition), m_points[point].id});
+        }
+        return;
+    }
+    int middle = begin + (end - begin) / 2;
+    const Point& split = m_points[middle];
+    query.consider(Candidate{findDistanceBetweenTwoPoints(position, LatLon(split.latitude, split.longitude)), split.id});
+
+    double offset = split.axis == 0 ? position.latitude() - split.latitude : position.longitude() - split.longitude;
+    double planeDistance = std::abs(offset) * kDegreeToRadian * (split.axis == 0 ? kEarthRadiusInMeters * kBoundSlack : longitudeScale);
+    //visit the side the query is on first, the other side only if it can still hold something closer
+    if (offset < 0) {
+        search(begin, middle, position, longitudeScale, query);
+        if (planeDistance <= query.bound()) {
+            search(middle + 1, end, position, longitudeScale, query);
+        }
+    } else {
+        search(middle + 1, end, position, longitudeScale, query);
+        if (planeDistance <= query.bound()) {
+            search(begin, middle, position, longitudeScale, query);
+        }
+    }
+}
+
+int SpatialIndex::nearest(LatLon position) const {
+    NearestQuery query;
+    search(0, m_points.size(), position, longitudeScaleFor(position), query);
+    return query.best.id;
+}
+
+std::vector<int> SpatialIndex::kNearest(LatLon position, size_t k) const {
+    KNearestQuery query(k);
+    if (k > 0) {
+        search(0, m_points.size(), position, longitudeScaleFor(position), query);
+    }
+    return sortedIds(query.heap);
+}
+
+std::vector<int> SpatialIndex::withinRadius(LatLon position, double radiusMeters) const {
+    RadiusQuery query(radiusMeters);
+    search(0, m_points.size(), position, longitudeScaleFor(position), query);
+    return sortedIds(query.found);
+}
+
+size_t SpatialIndex::memoryBytes() const {
+    return sizeof(SpatialIndex) + m_points.capacity() * sizeof(Point) + m_latitudeRange.capacity() * sizeof(float);
+}
+
+void SpatialIndex::clear() {
+    m_points.clear();
+    m_points.shrink_to_fit();
+    m_latitudeRange.clear();
+}
+
+bool SpatialIndex::columnsConsistent(int idLimit) const {
+    if (m_latitudeRange.size() != 2) {
+        return false;
+    }
+    for (const Point& point : m_points) {
+        if (point.id < 0 || point.id >= idLimit || point.axis < 0 || point.axis > 1 ||
+            point.latitude < m_latitudeRange[0] || point.latitude > m_latitudeRange[1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CategorySpatialIndex::build(const std::vector<LatLon>& positions, const std::vector<std::string>& categories) {
+    clear();
+    std::vector<std::vector<LatLon>> bucketPositions;
+    std::vector<std::vector<int>> bucketIds;
+    for (size_t point = 0; point < positions.size(); point++) {
+        uint32_t category = m_categories.intern(categories[point]);
+        if (category == bucketIds.size()) {
+            bucketPositions.emplace_back();
+            bucketIds.emplace_back();
+        }
+        bucketPositions[category].push_back(positions[point]);
+        bucketIds[category].push_back(point);
+    }
+    m_categories.freeze(true);
+    m_indexes.resize(bucketIds.size());
+    for (size_t category = 0; category < bucketIds.size(); category++) {
+        m_indexes[category].build(bucketPositions[category], bucketIds[category]);
+    }
+}
+
+const SpatialIndex* CategorySpatialIndex::indexOf(std::string_view category) const {
+    uint32_t bucket;
+    if (!m_categories.find(category, bucket)) {
+        return nullptr;
+    }
+    return &m_indexes[bucket];
+}
+
+int CategorySpatialIndex::nearest(LatLon position, std::string_view category) const {
+    const SpatialIndex* index = indexOf(category);
+    return index == nullptr ? -1 : index->nearest(position);
+}
+
+std::vector<int> CategorySpatialIndex::kNearest(LatLon position, std::string_view category, size_t k) const {
+    const SpatialIndex* index = indexOf(category);
+    return index == nullptr ? std::vector<int>() : index->kNearest(position, k);
+}
+
+std::vector<int> CategorySpatialIndex::withinRadius(LatLon position, std::string_view category, double radiusMeters) const {
+    const SpatialIndex* index = indexOf(category);
+    return index == nullptr ? std::vector<int>() : index->withinRadius(position, radiusMeters);
+}
+
+size_t CategorySpatialIndex::size() const {
+    size_t points = 0;
+    for (const SpatialIndex& index : m_indexes) {
+        points += index.size();
+    }
+    return points;
+}
+
+size_t CategorySpatialIndex::memoryBytes() const {
+    size_t bytes = sizeof(CategorySpatialIndex) + m_categories.memoryBytes();
+    for (const SpatialIndex& index : m_indexes) {
+        bytes += index.memoryBytes();
+    }
+    return bytes;
+}
+
+void CategorySpatialIndex::clear() {
+    m_categories.clear();
+    m_indexes.clear();
+    m_indexes.shrink_to_fit();
+}
+
+bool CategorySpatialIndex::columnsConsistent(int idLimit) const {
+    if (!m_categories.consistent() || m_indexes.size() != m_categories.size()) {
+        return false;
+    }
+    for (const SpatialIndex& index : m_indexes) {
+        if (!index.columnsConsistent(idLimit)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "LatLon.h"
+#include "osmTagStore.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Static k-d tree over LatLon points with exact queries in the findDistanceBetweenTwoPoints
+//metric. The tree is implicit: every range [begin, end) of the point array stores its
+//split point at the middle, so the only memory is the points themselves.
+//Distance ties are broken towards the larger id, like a linear scan that keeps the last minimum.
+class SpatialIndex {
+public:
+    //ids[i] is reported for positions[i]; with no ids the position index is the id
+    void build(const std::vector<LatLon>& positions, const std::vector<int>& ids = {});
+
+    //Id of the closest point, or -1 if the index is empty
+    int nearest(LatLon position) const;
+    //Ids of the k closest points, closest first
+    std::vector<int> kNearest(LatLon position, size_t k) const;
+    //Ids of every point within radiusMeters, closest first
+    std::vector<int> withinRadius(LatLon position, double radiusMeters) const;
+
+    size_t size() const { return m_points.size(); }
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if the tree is well formed and every id is below idLimit
+    bool columnsConsistent(int idLimit) const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_points);
+        visit(m_latitudeRange);
+    }
+
+private:
+    struct Point {
+        float latitude;
+        float longitude;
+        int32_t id;
+        int32_t axis;       //0 splits on latitude, 1 on longitude (only meaningful for split points)
+    };
+    template <typename Query>
+    void search(int begin, int end, LatLon position, double longitudeScale, Query& query) const;
+    double longitudeScaleFor(LatLon position) const;
+
+    std::vector<Point> m_points;
+    std::vector<float> m_latitudeRange;     //{min, max} latitude of the points, bounds the cosine in the metric
+};
+
+//Points bucketed by an interned category string (e.g. POI type), one SpatialIndex per category.
+//Queries for an unknown category find nothing.
+class CategorySpatialIndex {
+public:
+    //categories[i] is the category of positions[i]; the position index is the reported id
+    void build(const std::vector<LatLon>& positions, const std::vector<std::string>& categories);
+
+    int nearest(LatLon position, std::string_view category) const;
+    std::vector<int> kNearest(LatLon position, std::string_view category, size_t k) const;
+    std::vector<int> withinRadius(LatLon position, std::string_view category, double radiusMeters) const;
+
+    //Index of one category, or nullptr if no point has it
+    const SpatialIndex* indexOf(std::string_view category) const;
+    size_t numCategories() const { return m_indexes.size(); }
+    size_t size() const;
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if every bucket is well formed with ids below idLimit; call finish() afterwards
+    bool columnsConsistent(int idLimit) const;
+    //Makes categories searchable after the columns were filled through visitColumns
+    void finish() { m_categories.freeze(true); }
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_categories.chars);
+        visit(m_categories.offsets);
+        //when reading, the bucket count is only known once the dictionary has been visited
+        m_indexes.resize(m_categories.size());
+        for (SpatialIndex& index : m_indexes) {
+            index.visitColumns(visit);
+        }
+    }
+
+private:
+    StringDictionary m_categories;
+    std::vector<SpatialIndex> m_indexes;    //bucket i holds the points of category m_categories[i]
+};
+
+#endif //SPATIALINDEX_H
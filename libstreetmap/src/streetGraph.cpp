@@ -0,0 +1,60 @@
+#include "streetGraph.h"
+#include "samiristhegoat.h"
+
+StreetGraph streetGraph;
+
+void StreetGraph::computeOffsets() {
+    m_edgeBegin.resize(getNumIntersections() + 1);
+    m_edgeBegin[0] = 0;
+    for (int intersection = 0; intersection < getNumIntersections(); intersection++) {
+        m_edgeBegin[intersection + 1] = m_edgeBegin[intersection] + getNumIntersectionStreetSegment(intersection);
+    }
+    //resize value-initializes, so the padding bytes written to the snapshot are zero
+    m_edges.clear();
+    m_edges.resize(m_edgeBegin.back());
+}
+
+void StreetGraph::fillEdges(IntersectionIdx begin, IntersectionIdx end) {
+    for (int intersection = begin; intersection < end; intersection++) {
+        for (uint32_t edgeNumber = m_edgeBegin[intersection]; edgeNumber < m_edgeBegin[intersection + 1]; edgeNumber++) {
+            StreetSegmentIdx segment = getIntersectionStreetSegment(intersection, edgeNumber - m_edgeBegin[intersection]);
+            const StreetSegmentInfo& info = street_segment_info[segment];
+            StreetGraphEdge& edge = m_edges[edgeNumber];
+            edge.travelTime = street_segment_length[segment] / info.speedLimit;
+            edge.to = info.to == intersection ? info.from : info.to;
+            edge.segment = segment;
+            edge.street = info.streetID;
+            edge.oneWay = info.oneWay;
+            edge.traversable = !info.oneWay || info.from == intersection;
+        }
+    }
+}
+
+size_t StreetGraph::memoryBytes() const {
+    return sizeof(StreetGraph) + m_edgeBegin.capacity() * sizeof(uint32_t) + m_edges.capacity() * sizeof(StreetGraphEdge);
+}
+
+void StreetGraph::clear() {
+    m_edgeBegin.assign(1, 0);
+    m_edgeBegin.shrink_to_fit();
+    m_edges.clear();
+    m_edges.shrink_to_fit();
+}
+
+bool StreetGraph::columnsConsistent() const {
+    if (m_edgeBegin.size() != static_cast<size_t>(getNumIntersections()) + 1 || m_edgeBegin.front() != 0 || m_edgeBegin.back() != m_edges.size()) {
+        return false;
+    }
+    for (int intersection = 0; intersection < getNumIntersections(); intersection++) {
+        if (m_edgeBegin[intersection + 1] < m_edgeBegin[intersection]) {
+            return false;
+        }
+    }
+    for (const StreetGraphEdge& edge : m_edges) {
+        if (edge.to < 0 || edge.to >= getNumIntersections() || edge.segment < 0 || edge.segment >= getNumStreetSegments() ||
+            edge.street < 0 || edge.street >= getNumStreets()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef STREETGRAPH_H
+#define STREETGRAPH_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <vector>
+
+//One street segment as seen from one of its end intersections
+struct StreetGraphEdge {
+    double travelTime;          //length / speed limit, same value as findStreetSegmentTravelTime
+    IntersectionIdx to;         //other end of the segment (the intersection itself for cul-de-sacs)
+    StreetSegmentIdx segment;
+    StreetIdx street;
+    bool oneWay;
+    bool traversable;           //false for one-way segments that point into this intersection
+};
+
+//Non-owning view of the edges of one intersection, usable in range-for loops
+class StreetGraphEdgeRange {
+public:
+    StreetGraphEdgeRange(const StreetGraphEdge* first, const StreetGraphEdge* last) : m_first(first), m_last(last) {}
+    const StreetGraphEdge* begin() const { return m_first; }
+    const StreetGraphEdge* end() const { return m_last; }
+    size_t size() const { return m_last - m_first; }
+    const StreetGraphEdge& operator[](size_t edge) const { return m_first[edge]; }
+private:
+    const StreetGraphEdge* m_first;
+    const StreetGraphEdge* m_last;
+};
+
+//Intersection adjacency in compressed sparse row form: the edges of intersection i
+//are edges[edgeBegin[i], edgeBegin[i + 1]), in the same order as getIntersectionStreetSegment.
+//Every segment appears once from each of its ends, including one-way segments.
+class StreetGraph {
+public:
+    //Building: computeOffsets() first, then fillEdges() on disjoint intersection ranges
+    //(safe in parallel) once street_segment_info and street_segment_length are loaded
+    void computeOffsets();
+    void fillEdges(IntersectionIdx begin, IntersectionIdx end);
+
+    StreetGraphEdgeRange edgesOf(IntersectionIdx intersection) const {
+        return StreetGraphEdgeRange(m_edges.data() + m_edgeBegin[intersection], m_edges.data() + m_edgeBegin[intersection + 1]);
+    }
+    int numIntersections() const { return static_cast<int>(m_edgeBegin.size()) - 1; }
+    size_t numEdges() const { return m_edges.size(); }
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if the offsets and edge targets are in range for the loaded map
+    bool columnsConsistent() const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_edgeBegin);
+        visit(m_edges);
+    }
+
+private:
+    std::vector<uint32_t> m_edgeBegin = std::vector<uint32_t>(1, 0);
+    std::vector<StreetGraphEdge> m_edges;
+};
+
+extern StreetGraph streetGraph;
+
+#endif //STREETGRAPH_H
@@ -0,0 +1,207 @@
+#include "streetIndex.h"
+#include <algorithm>
+#include <cctype>
+
+StreetIntersectionIndex streetIntersectionIndex;
+StreetNameIndex streetNameIndex;
+
+namespace {
+
+//Beyond this size ratio, binary searching the long run beats walking it
+const size_t kGallopRatio = 16;
+
+void gallopingIntersect(IntersectionRange small, IntersectionRange large, std::vector<IntersectionIdx>& out) {
+    const IntersectionIdx* position = large.begin();
+    for (IntersectionIdx value : small) {
+        //double the step until we pass value, then binary search inside the last step
+        size_t step = 1;
+        const IntersectionIdx* bound = position;
+        while (bound < large.end() && *bound < value) {
+            position = bound;
+            bound = large.end() - bound > static_cast<std::ptrdiff_t>(step) ? bound + step : large.end();
+            step *= 2;
+        }
+        position = std::lower_bound(position, bound, value);
+        if (position == large.end()) {
+            return;
+        }
+        if (*position == value) {
+            out.push_back(value);
+        }
+    }
+}
+
+void mergeIntersect(IntersectionRange a, IntersectionRange b, std::vector<IntersectionIdx>& out) {
+    const IntersectionIdx* first = a.begin();
+    const IntersectionIdx* second = b.begin();
+    //both cursors advance without a data-dependent branch, equal values advance both
+    while (first != a.end() && second != b.end()) {
+        IntersectionIdx x = *first;
+        IntersectionIdx y = *second;
+        if (x == y) {
+            out.push_back(x);
+        }
+        first += x <= y;
+        second += y <= x;
+    }
+}
+
+} //namespace
+
+void intersectSorted(IntersectionRange a, IntersectionRange b, std::vector<IntersectionIdx>& out) {
+    if (a.size() > b.size()) {
+        std::swap(a, b);
+    }
+    if (a.empty() || a.begin()[0] > b.end()[-1] || b.begin()[0] > a.end()[-1]) {
+        return;
+    }
+    if (b.size() >= kGallopRatio * a.size()) {
+        gallopingIntersect(a, b, out);
+    } else {
+        mergeIntersect(a, b, out);
+    }
+}
+
+void StreetIntersectionIndex::build(std::vector<std::vector<IntersectionIdx>>& perStreet) {
+    m_streetBegin.resize(perStreet.size() + 1);
+    m_streetBegin[0] = 0;
+    for (size_t street = 0; street < perStreet.size(); street++) {
+        std::vector<IntersectionIdx>& intersections = perStreet[street];
+        std::sort(intersections.begin(), intersections.end());
+        intersections.erase(std::unique(intersections.begin(), intersections.end()), intersections.end());
+        m_streetBegin[street + 1] = m_streetBegin[street] + intersections.size();
+    }
+    m_intersections.clear();
+    m_intersections.reserve(m_streetBegin.back());
+    for (std::vector<IntersectionIdx>& intersections : perStreet) {
+        m_intersections.insert(m_intersections.end(), intersections.begin(), intersections.end());
+        std::vector<IntersectionIdx>().swap(intersections);
+    }
+}
+
+void StreetIntersectionIndex::appendCommonIntersections(StreetIdx street1, StreetIdx street2, std::vector<IntersectionIdx>& out) const {
+    intersectSorted(intersectionsOf(street1), intersectionsOf(street2), out);
+}
+
+size_t StreetIntersectionIndex::memoryBytes() const {
+    return sizeof(StreetIntersectionIndex) + m_streetBegin.capacity() * sizeof(uint32_t) + m_intersections.capacity() * sizeof(IntersectionIdx);
+}
+
+void StreetIntersectionIndex::clear() {
+    m_streetBegin.assign(1, 0);
+    m_streetBegin.shrink_to_fit();
+    m_intersections.clear();
+    m_intersections.shrink_to_fit();
+}
+
+bool StreetIntersectionIndex::columnsConsistent() const {
+    if (m_streetBegin.size() != static_cast<size_t>(getNumStreets()) + 1 || m_streetBegin.front() != 0 || m_streetBegin.back() != m_intersections.size()) {
+        return false;
+    }
+    for (int street = 0; street < getNumStreets(); street++) {
+        if (m_streetBegin[street + 1] < m_streetBegin[street]) {
+            return false;
+        }
+        for (uint32_t entry = m_streetBegin[street]; entry < m_streetBegin[street + 1]; entry++) {
+            IntersectionIdx intersection = m_intersections[entry];
+            if (intersection < 0 || intersection >= getNumIntersections() || (entry > m_streetBegin[street] && m_intersections[entry - 1] >= intersection)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string StreetNameIndex::normalize(std::string_view name) {
+    std::string normalized;
+    normalized.reserve(name.size());
+    for (char letter : name) {
+        if (letter != ' ') {
+            normalized.push_back(std::tolower(static_cast<unsigned char>(letter)));
+        }
+    }
+    return normalized;
+}
+
+void StreetNameIndex::build() {
+    m_chars.clear();
+    m_entries.resize(getNumStreets());
+    for (int street = 0; street < getNumStreets(); street++) {
+        std::string name = normalize(getStreetName(street));
+        m_entries[street].offset = m_chars.size();
+        m_entries[street].length = name.size();
+        m_entries[street].street = street;
+        m_chars.insert(m_chars.end(), name.begin(), name.end());
+    }
+    std::sort(m_entries.begin(), m_entries.end(), [this](const NameEntry& a, const NameEntry& b) {
+        int order = nameOf(a).compare(nameOf(b));
+        return order < 0 || (order == 0 && a.street < b.street);
+    });
+    m_chars.shrink_to_fit();
+}
+
+std::pair<const StreetNameIndex::NameEntry*, const StreetNameIndex::NameEntry*> StreetNameIndex::prefixRange(std::string_view prefix) const {
+    //names starting with prefix sort together: from the first name >= prefix up to the first
+    //name whose leading prefix.size() characters compare greater
+    const NameEntry* first = std::lower_bound(m_entries.data(), m_entries.data() + m_entries.size(), prefix,
+        [this](const NameEntry& entry, std::string_view value) { return nameOf(entry) < value; });
+    const NameEntry* last = std::upper_bound(first, m_entries.data() + m_entries.size(), prefix,
+        [this](std::string_view value, const NameEntry& entry) { return value < nameOf(entry).substr(0, value.size()); });
+    return std::make_pair(first, last);
+}
+
+std::vector<StreetIdx> StreetNameIndex::streetsWithPrefix(std::string_view prefix) const {
+    std::vector<StreetIdx> streets;
+    if (prefix.empty()) {
+        return streets;
+    }
+    auto range = prefixRange(prefix);
+    streets.reserve(range.second - range.first);
+    for (const NameEntry* entry = range.first; entry != range.second; entry++) {
+        streets.push_back(entry->street);
+    }
+    std::sort(streets.begin(), streets.end());
+    return streets;
+}
+
+std::vector<StreetIdx> StreetNameIndex::streetsWithPrefix(std::string_view prefix, size_t maxResults) const {
+    std::vector<StreetIdx> streets;
+    if (prefix.empty()) {
+        return streets;
+    }
+    auto range = prefixRange(prefix);
+    size_t numResults = std::min<size_t>(range.second - range.first, maxResults);
+    streets.reserve(numResults);
+    for (const NameEntry* entry = range.first; entry != range.first + numResults; entry++) {
+        streets.push_back(entry->street);
+    }
+    return streets;
+}
+
+size_t StreetNameIndex::memoryBytes() const {
+    return sizeof(StreetNameIndex) + m_chars.capacity() + m_entries.capacity() * sizeof(NameEntry);
+}
+
+void StreetNameIndex::clear() {
+    m_chars.clear();
+    m_chars.shrink_to_fit();
+    m_entries.clear();
+    m_entries.shrink_to_fit();
+}
+
+bool StreetNameIndex::columnsConsistent() const {
+    if (m_entries.size() != static_cast<size_t>(getNumStreets())) {
+        return false;
+    }
+    for (size_t entry = 0; entry < m_entries.size(); entry++) {
+        const NameEntry& current = m_entries[entry];
+        if (current.offset > m_chars.size() || current.length > m_chars.size() - current.offset ||
+            current.street < 0 || current.street >= getNumStreets()) {
+            return false;
+        }
+        if (entry > 0 && nameOf(m_entries[entry - 1]) > nameOf(current)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef STREETINDEX_H
+#define STREETINDEX_H
+
+#include "StreetsDatabaseAPI.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Non-owning view of a sorted run of intersection ids
+class IntersectionRange {
+public:
+    IntersectionRange(const IntersectionIdx* first, const IntersectionIdx* last) : m_first(first), m_last(last) {}
+    const IntersectionIdx* begin() const { return m_first; }
+    const IntersectionIdx* end() const { return m_last; }
+    size_t size() const { return m_last - m_first; }
+    bool empty() const { return m_first == m_last; }
+private:
+    const IntersectionIdx* m_first;
+    const IntersectionIdx* m_last;
+};
+
+//Intersections of every street as one flat array: street s owns the sorted, duplicate-free
+//run intersections[streetBegin[s], streetBegin[s + 1]).
+class StreetIntersectionIndex {
+public:
+    //perStreet[s] holds the intersections of street s in any order, with duplicates; it is consumed
+    void build(std::vector<std::vector<IntersectionIdx>>& perStreet);
+
+    IntersectionRange intersectionsOf(StreetIdx street) const {
+        return IntersectionRange(m_intersections.data() + m_streetBegin[street], m_intersections.data() + m_streetBegin[street + 1]);
+    }
+    //Appends the intersections shared by both streets to out, in increasing id order
+    void appendCommonIntersections(StreetIdx street1, StreetIdx street2, std::vector<IntersectionIdx>& out) const;
+
+    int numStreets() const { return static_cast<int>(m_streetBegin.size()) - 1; }
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if the offsets and ids are in range and every run is strictly increasing
+    bool columnsConsistent() const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_streetBegin);
+        visit(m_intersections);
+    }
+
+private:
+    std::vector<uint32_t> m_streetBegin = std::vector<uint32_t>(1, 0);
+    std::vector<IntersectionIdx> m_intersections;
+};
+
+//Street names with spaces removed and lowercased, sorted so that every prefix query is
+//one binary-searched range. Memory is one entry plus the name characters per street.
+class StreetNameIndex {
+public:
+    //Lowercases and drops spaces, the form both names and queries are compared in
+    static std::string normalize(std::string_view name);
+
+    void build();
+
+    //Streets whose normalized name starts with the normalized prefix, in increasing id order
+    std::vector<StreetIdx> streetsWithPrefix(std::string_view prefix) const;
+    //At most maxResults of them, in alphabetical order of name (so an exact match comes first)
+    std::vector<StreetIdx> streetsWithPrefix(std::string_view prefix, size_t maxResults) const;
+
+    size_t memoryBytes() const;
+    void clear();
+
+    //True if every entry points inside the name buffer and the entries are in name order
+    bool columnsConsistent() const;
+
+    //Calls visit(vector&) on every column in a fixed order; used to write and read the map snapshot
+    template <typename Visitor>
+    void visitColumns(Visitor&& visit) {
+        visit(m_chars);
+        visit(m_entries);
+    }
+
+private:
+    struct NameEntry {
+        uint32_t offset;
+        uint32_t length;
+        StreetIdx street;
+    };
+
+    std::string_view nameOf(const NameEntry& entry) const {
+        return std::string_view(m_chars.data() + entry.offset, entry.length);
+    }
+    //Entries whose name starts with the already normalized prefix
+    std::pair<const NameEntry*, const NameEntry*> prefixRange(std::string_view prefix) const;
+
+    std::vector<char> m_chars;
+    std::vector<NameEntry> m_entries;           //sorted by name, then street id
+};
+
+//Sorted intersection runs a and b, appends a ∩ b to out
+void intersectSorted(IntersectionRange a, IntersectionRange b, std::vector<IntersectionIdx>& out);
+
+extern StreetIntersectionIndex streetIntersectionIndex;
+extern StreetNameIndex streetNameIndex;
+
+#endif //STREETINDEX_H
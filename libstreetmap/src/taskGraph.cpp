@@ -0,0 +1,218 @@
+#include "taskGraph.h"
+#include "loadProfiler.h"
+#include <algorithm>
+#include <iomanip>
+
+TaskGraph::TaskGraph(unsigned numThreads) : m_numThreads(std::max(1u, numThreads)) {
+}
+
+TaskGraph::TaskId TaskGraph::addTask(const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies) {
+    return addTask(name, name, std::move(work), dependencies);
+}
+
+TaskGraph::TaskId TaskGraph::addTask(const std::string& name, const std::string& phase, std::function<void()> work, const std::vector<TaskId>& dependencies) {
+    TaskId id = m_tasks.size();
+    Task task;
+    task.work = std::move(work);
+    task.dependencies = dependencies;
+    for (TaskId dependency : dependencies) {
+        m_tasks[dependency].dependents.push_back(id);
+    }
+    m_tasks.push_back(std::move(task));
+
+    TaskTiming timing;
+    timing.name = name;
+    timing.phase = phase;
+    m_timings.push_back(timing);
+    return id;
+}
+
+TaskGraph::TaskId TaskGraph::addParallelFor(const std::string& name, int begin, int end, int chunkSize,
+                                            std::function<void(int chunkBegin, int chunkEnd)> body, const std::vector<TaskId>& dependencies) {
+    chunkSize = std::max(1, chunkSize);
+    std::vector<TaskId> chunks;
+    for (int chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+        int chunkEnd = std::min(end, chunkBegin + chunkSize);
+        chunks.push_back(addTask(name + "[" + std::to_string(chunkBegin) + "," + std::to_string(chunkEnd) + ")", name,
+                                 [body, chunkBegin, chunkEnd]() { body(chunkBegin, chunkEnd); }, dependencies));
+    }
+    //empty ranges still need a join task that waits on the dependencies
+    if (chunks.empty()) {
+        chunks = dependencies;
+    }
+    return addTask(name, "", []() {}, chunks);
+}
+
+int TaskGraph::chunkSizeFor(int numElements) const {
+    const int chunksPerThread = 4;
+    const int minChunkSize = 64;
+    return std::max(minChunkSize, numElements / static_cast<int>(m_numThreads * chunksPerThread) + 1);
+}
+
+void TaskGraph::run() {
+    if (m_tasks.empty()) {
+        return;
+    }
+    m_queues.clear();
+    for (unsigned worker = 0; worker < m_numThreads; worker++) {
+        m_queues.emplace_back(new WorkerQueue());
+    }
+    m_unfinishedDependencies.reset(new std::atomic<int>[m_tasks.size()]);
+    m_remaining = m_tasks.size();
+    m_queued = 0;
+    m_error = nullptr;
+    m_runStart = std::chrono::steady_clock::now();
+
+    //seed the roots round-robin so every worker starts with something to do
+    int nextWorker = 0;
+    for (TaskId task = 0; task < static_cast<TaskId>(m_tasks.size()); task++) {
+        m_unfinishedDependencies[task] = m_tasks[task].dependencies.size();
+        if (m_tasks[task].dependencies.empty()) {
+            push(nextWorker, task);
+            nextWorker = (nextWorker + 1) % m_numThreads;
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned worker = 1; worker < m_numThreads; worker++) {
+        workers.emplace_back(&TaskGraph::workerLoop, this, worker);
+    }
+    workerLoop(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    m_queues.clear();
+
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void TaskGraph::workerLoop(int worker) {
+    while (m_remaining > 0) {
+        TaskId task;
+        if (popLocal(worker, task) || steal(worker, task)) {
+            execute(worker, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> idleLock(m_idleLock);
+        m_idle.wait(idleLock, [this]() { return m_queued > 0 || m_remaining == 0; });
+    }
+}
+
+bool TaskGraph::popLocal(int worker, TaskId& task) {
+    WorkerQueue& queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    m_queued--;
+    return true;
+}
+
+bool TaskGraph::steal(int worker, TaskId& task) {
+    for (unsigned offset = 1; offset < m_numThreads; offset++) {
+        WorkerQueue& victim = *m_queues[(worker + offset) % m_numThreads];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskGraph::push(int worker, TaskId task) {
+    {
+        std::lock_guard<std::mutex> lock(m_queues[worker]->lock);
+        m_queues[worker]->tasks.push_back(task);
+    }
+    {
+        //counted under the idle lock so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> idleLock(m_idleLock);
+        m_queued++;
+    }
+    m_idle.notify_one();
+}
+
+void TaskGraph::execute(int worker, TaskId task) {
+    TaskTiming& timing = m_timings[task];
+    timing.worker = worker;
+    timing.start = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_runStart).count();
+    uint64_t bytesAtStart = threadAllocatedBytes();
+    try {
+        m_tasks[task].work();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_errorLock);
+        if (!m_error) {
+            m_error = std::current_exception();
+        }
+    }
+    timing.end = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_runStart).count();
+    timing.bytesAllocated = threadAllocatedBytes() - bytesAtStart;
+
+    for (TaskId dependent : m_tasks[task].dependents) {
+        if (--m_unfinishedDependencies[dependent] == 0) {
+            push(worker, dependent);
+        }
+    }
+    if (--m_remaining == 0) {
+        std::lock_guard<std::mutex> idleLock(m_idleLock);
+        m_idle.notify_all();
+    }
+}
+
+std::vector<TaskGraph::TaskId> TaskGraph::criticalPath() const {
+    //ids are topologically ordered, so one forward pass finds the heaviest chain
+    std::vector<double> pathTime(m_tasks.size(), 0);
+    std::vector<TaskId> previous(m_tasks.size(), -1);
+    TaskId last = -1;
+    for (TaskId task = 0; task < static_cast<TaskId>(m_tasks.size()); task++) {
+        for (TaskId dependency : m_tasks[task].dependencies) {
+            if (pathTime[dependency] > pathTime[task]) {
+                pathTime[task] = pathTime[dependency];
+                previous[task] = dependency;
+            }
+        }
+        pathTime[task] += m_timings[task].end - m_timings[task].start;
+        if (last == -1 || pathTime[task] > pathTime[last]) {
+            last = task;
+        }
+    }
+
+    std::vector<TaskId> path;
+    for (TaskId task = last; task != -1; task = previous[task]) {
+        path.push_back(task);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void TaskGraph::printCriticalPath(std::ostream& out) const {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    double span = 0;
+    double work = 0;
+    double wallClock = 0;
+    for (const TaskTiming& timing : m_timings) {
+        work += timing.end - timing.start;
+        wallClock = std::max(wallClock, timing.end);
+    }
+
+    std::vector<TaskId> path = criticalPath();
+    out << "Critical path:";
+    for (TaskId task : path) {
+        double duration = m_timings[task].end - m_timings[task].start;
+        span += duration;
+        out << (task == path.front() ? " " : " -> ") << m_timings[task].name << " (" << std::fixed << std::setprecision(3) << duration << "s)";
+    }
+    out << std::endl;
+    out << "Span " << span << "s, work " << work << "s, wall clock " << wallClock << "s on "
+        << m_numThreads << " threads" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,94 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Small dependency-aware scheduler used to run the loadMap phases as a DAG.
+//Every worker owns a deque: it pops its own newest task and steals the oldest
+//task of another worker when it runs dry. Tasks may only depend on tasks that
+//were added before them, so the ids are always in topological order.
+class TaskGraph {
+public:
+    typedef int TaskId;
+
+    //Timing of one executed task, in seconds since run() started
+    struct TaskTiming {
+        std::string name;
+        std::string phase;          //chunks of one parallel loop share the loop's phase; empty for join tasks
+        double start = 0;
+        double end = 0;
+        int worker = 0;
+        uint64_t bytesAllocated = 0;
+    };
+
+    explicit TaskGraph(unsigned numThreads = std::thread::hardware_concurrency());
+
+    TaskId addTask(const std::string& name, std::function<void()> work, const std::vector<TaskId>& dependencies = {});
+    TaskId addTask(const std::string& name, const std::string& phase, std::function<void()> work, const std::vector<TaskId>& dependencies);
+
+    //Splits [begin, end) into chunks of chunkSize elements, one task per chunk.
+    //Returns a task that completes once every chunk is done, so later phases can depend on the whole loop.
+    TaskId addParallelFor(const std::string& name, int begin, int end, int chunkSize,
+                          std::function<void(int chunkBegin, int chunkEnd)> body, const std::vector<TaskId>& dependencies = {});
+
+    //Chunk size that gives every worker a few chunks of [0, numElements) to balance uneven work
+    int chunkSizeFor(int numElements) const;
+
+    //Executes every task (the calling thread is one of the workers) and blocks until all are done.
+    //The first exception thrown by a task is rethrown here once the graph has drained.
+    void run();
+
+    //Longest chain of dependent tasks weighted by measured durations
+    std::vector<TaskId> criticalPath() const;
+    void printCriticalPath(std::ostream& out) const;
+
+    const std::vector<TaskTiming>& timings() const { return m_timings; }
+    unsigned numThreads() const { return m_numThreads; }
+    std::chrono::steady_clock::time_point runStart() const { return m_runStart; }
+
+private:
+    struct Task {
+        std::function<void()> work;
+        std::vector<TaskId> dependencies;
+        std::vector<TaskId> dependents;
+    };
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<TaskId> tasks;
+    };
+
+    void workerLoop(int worker);
+    bool popLocal(int worker, TaskId& task);
+    bool steal(int worker, TaskId& task);
+    void push(int worker, TaskId task);
+    void execute(int worker, TaskId task);
+
+    unsigned m_numThreads;
+    std::vector<Task> m_tasks;
+    std::vector<TaskTiming> m_timings;
+
+    //run-time state, only valid inside run()
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::unique_ptr<std::atomic<int>[]> m_unfinishedDependencies;
+    std::atomic<int> m_remaining{0};
+    std::atomic<int> m_queued{0};
+    std::mutex m_idleLock;
+    std::condition_variable m_idle;
+    std::mutex m_errorLock;
+    std::exception_ptr m_error;
+    std::chrono::steady_clock::time_point m_runStart;
+};
+
+#endif //TASKGRAPH_H
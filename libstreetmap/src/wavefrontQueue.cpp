@@ -0,0 +1,127 @@
+#include "wavefrontQueue.h"
+
+void IndexedQuadHeap::resize(int numIds) {
+    m_heap.clear();
+    m_slot.assign(numIds, -1);
+}
+
+void IndexedQuadHeap::clear() {
+    for (const Entry& entry : m_heap) {
+        m_slot[entry.id] = -1;
+    }
+    m_heap.clear();
+}
+
+size_t IndexedQuadHeap::memoryBytes() const {
+    return sizeof(IndexedQuadHeap) + m_heap.capacity() * sizeof(Entry) + m_slot.capacity() * sizeof(int32_t);
+}
+
+void RadixHeap::resize(int numIds) {
+    for (std::vector<Entry>& bucket : m_buckets) {
+        bucket.clear();
+    }
+    m_last = 0;
+    m_live = 0;
+    m_keyBits.assign(numIds, 0);
+    m_queued.assign(numIds, false);
+}
+
+void RadixHeap::clear() {
+    for (std::vector<Entry>& bucket : m_buckets) {
+        for (const Entry& entry : bucket) {
+            m_queued[entry.id] = false;
+        }
+        bucket.clear();
+    }
+    m_last = 0;
+    m_live = 0;
+}
+
+void RadixHeap::rebase() {
+    //every live entry of the minimum's bucket lands in a lower one relative to the new last key
+    std::vector<Entry>& bucket = m_buckets[bucketOf(m_top.bits)];
+    m_last = m_top.bits;
+    for (const Entry& entry : bucket) {
+        if (!stale(entry)) {
+            m_buckets[bucketOf(entry.bits)].push_back(entry);
+        }
+    }
+    bucket.clear();
+}
+
+void RadixHeap::findMinimum() {
+    std::vector<Entry>& front = m_buckets[0];
+    while (!front.empty() && stale(front.back())) {
+        front.pop_back();
+    }
+    if (!front.empty()) {
+        m_top = front.back();
+        return;
+    }
+    //otherwise the smallest live key sits in the first bucket with a live entry
+    for (int index = 1; index < kNumBuckets; index++) {
+        std::vector<Entry>& bucket = m_buckets[index];
+        m_top.id = -1;
+        for (const Entry& entry : bucket) {
+            if (!stale(entry) && (m_top.id < 0 || entry.bits < m_top.bits)) {
+                m_top = entry;
+            }
+        }
+        if (m_top.id >= 0) {
+            return;
+        }
+        bucket.clear();
+    }
+}
+
+size_t RadixHeap::memoryBytes() const {
+    size_t bytes = sizeof(RadixHeap) + m_keyBits.capacity() * sizeof(uint64_t) + m_queued.capacity() / 8;
+    for (const std::vector<Entry>& bucket : m_buckets) {
+        bytes += bucket.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
+
+void DialQueue::resize(int numIds) {
+    m_buckets.clear();
+    m_current = 0;
+    m_live = 0;
+    m_key.assign(numIds, 0);
+    m_queued.assign(numIds, false);
+}
+
+void DialQueue::clear() {
+    //buckets before the current one were drained on the way
+    for (size_t index = m_current; index < m_buckets.size(); index++) {
+        for (const Entry& entry : m_buckets[index]) {
+            m_queued[entry.id] = false;
+        }
+        m_buckets[index].clear();
+    }
+    m_current = 0;
+    m_live = 0;
+}
+
+void DialQueue::settleMinimum() {
+    while (m_live > 0) {
+        std::vector<Entry>& bucket = m_buckets[m_current];
+        while (!bucket.empty() && stale(bucket.front())) {
+            std::pop_heap(bucket.begin(), bucket.end(), later);
+            bucket.pop_back();
+        }
+        if (!bucket.empty()) {
+            return;
+        }
+        m_current++;
+        std::make_heap(m_buckets[m_current].begin(), m_buckets[m_current].end(), later);
+    }
+}
+
+size_t DialQueue::memoryBytes() const {
+    size_t bytes = sizeof(DialQueue) + m_buckets.capacity() * sizeof(std::vector<Entry>) + m_key.capacity() * sizeof(double) +
+                   m_queued.capacity() / 8;
+    for (const std::vector<Entry>& bucket : m_buckets) {
+        bytes += bucket.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
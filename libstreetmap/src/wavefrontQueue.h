@@ -0,0 +1,251 @@
+#ifndef WAVEFRONTQUEUE_H
+#define WAVEFRONTQUEUE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//Addressable min-queues over ids [0, numIds) for the routing wavefront. Every id is queued at
+//most once: push inserts it, or lowers its key if it is already queued (a larger key is
+//ignored), so searches never pile up stale duplicates. All three share one interface and the
+//searches are templates over it:
+//    resize(numIds), clear(), empty(), push(id, key), top(), topKey(), pop(), memoryBytes()
+//RadixHeap and DialQueue are monotone: a key below the last popped one is raised to it, which
+//is exact for A* with a consistent heuristic and for Dijkstra. IndexedQuadHeap takes any key.
+
+//Implicit 4-ary heap with a slot per id for decrease-key; shallower than a binary heap and
+//the four children of a node share a cache line
+class IndexedQuadHeap {
+public:
+    void resize(int numIds);
+    //Empties the queue in O(size)
+    void clear();
+
+    int numIds() const { return static_cast<int>(m_slot.size()); }
+    bool empty() const { return m_heap.empty(); }
+    void push(int id, double key) {
+        int32_t slot = m_slot[id];
+        if (slot < 0) {
+            m_heap.push_back(Entry{key, id});
+            siftUp(m_heap.size() - 1);
+        } else if (key < m_heap[slot].key) {
+            m_heap[slot].key = key;
+            siftUp(slot);
+        }
+    }
+    int top() const { return m_heap.front().id; }
+    double topKey() const { return m_heap.front().key; }
+    void pop() {
+        m_slot[m_heap.front().id] = -1;
+        Entry last = m_heap.back();
+        m_heap.pop_back();
+        if (!m_heap.empty()) {
+            m_heap.front() = last;
+            siftDown(0);
+        }
+    }
+
+    size_t memoryBytes() const;
+
+private:
+    struct Entry {
+        double key;
+        int32_t id;
+    };
+
+    void siftUp(size_t slot) {
+        Entry entry = m_heap[slot];
+        while (slot > 0) {
+            size_t parent = (slot - 1) / 4;
+            if (m_heap[parent].key <= entry.key) {
+                break;
+            }
+            place(slot, m_heap[parent]);
+            slot = parent;
+        }
+        place(slot, entry);
+    }
+    void siftDown(size_t slot) {
+        Entry entry = m_heap[slot];
+        size_t size = m_heap.size();
+        while (true) {
+            size_t first = 4 * slot + 1;
+            if (first >= size) {
+                break;
+            }
+            size_t best = first;
+            size_t last = first + 4 < size ? first + 4 : size;
+            for (size_t child = first + 1; child < last; child++) {
+                if (m_heap[child].key < m_heap[best].key) {
+                    best = child;
+                }
+            }
+            if (entry.key <= m_heap[best].key) {
+                break;
+            }
+            place(slot, m_heap[best]);
+            slot = best;
+        }
+        place(slot, entry);
+    }
+    void place(size_t slot, Entry entry) {
+        m_heap[slot] = entry;
+        m_slot[entry.id] = static_cast<int32_t>(slot);
+    }
+
+    std::vector<Entry> m_heap;
+    std::vector<int32_t> m_slot;        //heap slot of each id, -1 when not queued
+};
+
+//Radix heap over the bit patterns of nonnegative doubles, which sort like the doubles. Bucket
+//b > 0 holds keys whose highest bit differing from the last popped key is bit b - 1, so a key
+//only ever moves to lower buckets and each push costs O(1) amortized plus at most 64 moves.
+//Decrease-key pushes a new entry; the old one is dropped when it surfaces.
+class RadixHeap {
+public:
+    void resize(int numIds);
+    void clear();
+
+    int numIds() const { return static_cast<int>(m_keyBits.size()); }
+    bool empty() const { return m_live == 0; }
+    void push(int id, double key) {
+        uint64_t bits = key > 0 ? bitsOf(key) : 0;
+        if (bits < m_last) {
+            bits = m_last;
+        }
+        if (m_queued[id]) {
+            if (bits >= m_keyBits[id]) {
+                return;
+            }
+        } else {
+            m_queued[id] = true;
+            m_live++;
+        }
+        m_keyBits[id] = bits;
+        m_buckets[bucketOf(bits)].push_back(Entry{bits, id});
+        if (m_live == 1 || bits < m_top.bits) {
+            m_top = Entry{bits, id};
+        }
+    }
+    int top() const { return m_top.id; }
+    double topKey() const { return keyOf(m_top.bits); }
+    void pop() {
+        if (m_top.bits != m_last) {
+            rebase();
+        }
+        //its entry turns stale and is dropped when it surfaces
+        m_queued[m_top.id] = false;
+        m_live--;
+        if (m_live > 0) {
+            findMinimum();
+        }
+    }
+
+    size_t memoryBytes() const;
+
+private:
+    static constexpr int kNumBuckets = 65;
+    struct Entry {
+        uint64_t bits;
+        int32_t id;
+    };
+
+    static uint64_t bitsOf(double key) {
+        uint64_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return bits;
+    }
+    static double keyOf(uint64_t bits) {
+        double key;
+        std::memcpy(&key, &bits, sizeof(key));
+        return key;
+    }
+    int bucketOf(uint64_t bits) const { return bits == m_last ? 0 : 64 - __builtin_clzll(bits ^ m_last); }
+    bool stale(const Entry& entry) const { return !m_queued[entry.id] || m_keyBits[entry.id] != entry.bits; }
+    //Makes the minimum the last key and spreads its bucket over the lower ones. Only pop does
+    //this: a key pushed between the last popped one and the minimum must keep its own value.
+    void rebase();
+    //Drops stale entries from the front and caches the smallest live entry in m_top
+    void findMinimum();
+
+    std::vector<Entry> m_buckets[kNumBuckets];
+    uint64_t m_last = 0;                //bits of the last popped key; every queued key is >= it
+    Entry m_top = {0, -1};              //smallest queued entry, valid while the queue is not empty
+    size_t m_live = 0;
+    std::vector<uint64_t> m_keyBits;
+    std::vector<bool> m_queued;
+};
+
+//Dial's bucket queue on integerized times: key k goes to bucket floor(k / kBucketWidth) and
+//buckets are drained in order. Later buckets are plain appends; the current one is heapified
+//when it becomes current, so the order stays exact and a crowded wavefront bucket costs
+//O(log b) per operation rather than a rescan.
+class DialQueue {
+public:
+    static constexpr double kBucketWidth = 1.0;        //seconds
+
+    void resize(int numIds);
+    void clear();
+
+    int numIds() const { return static_cast<int>(m_key.size()); }
+    bool empty() const { return m_live == 0; }
+    void push(int id, double key) {
+        if (m_queued[id]) {
+            if (key >= m_key[id]) {
+                return;
+            }
+        } else {
+            m_queued[id] = true;
+            m_live++;
+        }
+        size_t bucket = key > 0 ? static_cast<size_t>(key / kBucketWidth) : 0;
+        if (bucket < m_current) {
+            bucket = m_current;
+        }
+        if (bucket >= m_buckets.size()) {
+            m_buckets.resize(bucket + 1);
+        }
+        m_key[id] = key;
+        m_buckets[bucket].push_back(Entry{key, id});
+        if (bucket == m_current) {
+            std::push_heap(m_buckets[bucket].begin(), m_buckets[bucket].end(), later);
+        }
+        if (m_live == 1) {
+            settleMinimum();
+        }
+    }
+    int top() const { return m_buckets[m_current].front().id; }
+    double topKey() const { return m_buckets[m_current].front().key; }
+    void pop() {
+        std::vector<Entry>& bucket = m_buckets[m_current];
+        m_queued[bucket.front().id] = false;
+        std::pop_heap(bucket.begin(), bucket.end(), later);
+        bucket.pop_back();
+        m_live--;
+        settleMinimum();
+    }
+
+    size_t memoryBytes() const;
+
+private:
+    struct Entry {
+        double key;
+        int32_t id;
+    };
+
+    //heap order of the current bucket: smallest key on top
+    static bool later(const Entry& a, const Entry& b) { return a.key > b.key; }
+    //decrease-key leaves the old entry behind; it is dropped when it surfaces
+    bool stale(const Entry& entry) const { return !m_queued[entry.id] || m_key[entry.id] != entry.key; }
+    //Drops stale entries off the current bucket and advances (heapifying) to the first live one
+    void settleMinimum();
+
+    std::vector<std::vector<Entry>> m_buckets;
+    size_t m_current = 0;               //no live key is in an earlier bucket; this one is a heap
+    size_t m_live = 0;
+    std::vector<double> m_key;
+    std::vector<bool> m_queued;
+};
+
+#endif //WAVEFRONTQUEUE_H
@@ -20,12 +20,14 @@
  */
 #include <iostream>
 #include <string>
+#include <cstdlib>
 
 #include "m1.h"
 #include "m2.h"
 #include "m3.h"
 #include "m4.h"
 #include "samiristhegoat.h"
+#include "routingBenchmark.h"
 
 //Program exit codes
 constexpr int SUCCESS_EXIT_CODE = 0;        //Everyting went OK
@@ -67,6 +69,14 @@ int main(int argc, char** argv) {
     
     std::cout << "Successfully loaded map '" << map_path << "'\n";
 
+    //MAPPER_ROUTING_BENCHMARK=<queries> compares the routing engines on this map and exits
+    const char* benchmarkQueries = std::getenv("MAPPER_ROUTING_BENCHMARK");
+    if(benchmarkQueries != nullptr) {
+        runRoutingBenchmark(std::cout, std::atoi(benchmarkQueries), 15);
+        closeMap();
+        return SUCCESS_EXIT_CODE;
+    }
+
 
      std::vector<DeliveryInf> deliveries;
         std::vector<IntersectionIdx> depots;